@@ -0,0 +1,278 @@
+#include "camera.hxx"       // camera
+#include "image.hxx"        // write_image
+#include "mesh.hxx"         // indexed_mesh, mesh
+#include "render_stats.hxx" // render_stats, stage_timer
+#include "sampler.hxx"      // sampler
+#include "scene.hxx"        // scene, parse_scene, build_scene, make_materials
+#include "sphere.hxx"       // sphere
+#include "sphere_set.hxx"   // sphere_set
+
+#include <algorithm>    // std::ranges::find
+#include <charconv>     // std::from_chars
+#include <chrono>       // std::chrono::duration, std::chrono::nanoseconds
+#include <cstddef>      // std::size_t
+#include <cstdint>      // uint32_t
+#include <filesystem>   // std::filesystem::path
+#include <format>       // std::format
+#include <functional>   // std::function
+#include <iostream>     // std::cout, std::cerr
+#include <memory>       // std::make_shared
+#include <span>         // std::span
+#include <sstream>      // std::ostringstream
+#include <stdexcept>    // std::invalid_argument, std::logic_error
+#include <string>       // std::string
+#include <string_view>  // std::string_view
+#include <system_error> // std::errc
+#include <thread>       // std::jthread
+#include <vector>       // std::vector
+
+#ifndef RAYONS_SCENE_DIR
+#define RAYONS_SCENE_DIR "scenes"
+#endif
+
+struct benchmark_case
+{
+    std::string name;
+    std::function<scene()> build;
+};
+
+struct benchmark_result
+{
+    std::string name;
+    std::size_t primitives{0};
+    std::chrono::nanoseconds build{0};
+    std::chrono::nanoseconds encode{0};
+    render_stats render;
+};
+
+/**
+ * @brief Loads a scene file of the repository, bypassing the scene cache so that the build is measured.
+ */
+auto scene_file(std::string_view name) -> scene
+{
+    auto const path = std::filesystem::path(RAYONS_SCENE_DIR) / name;
+
+    return build_scene(parse_scene(read_text_file(path), path.parent_path()));
+}
+
+auto primitive_count(scene const& s) -> std::size_t
+{
+    auto count = s.spheres ? s.spheres->spheres().size() : 0;
+
+    for (auto const& m : s.meshes) { count += m->data().faces.size(); }
+
+    return count;
+}
+
+/**
+ * @brief Small spheres scattered in front of the camera, always the same ones.
+ */
+auto sphere_field(uint32_t count) -> scene
+{
+    scene s;
+    s.lights.emplace_back(light{vec3{0.0, 2.0, 2.0}, color{1.0, 1.0, 1.0}, 10.0});
+    material_description diffuse;
+    diffuse.kind = material_kind::lambertian;
+    diffuse.albedo = color{0.2, 0.6, 0.3};
+    s.material_descriptions.push_back(diffuse);
+    s.materials = make_materials(s.material_descriptions);
+
+    material_id const material{0};
+    sampler rng(1);
+    std::vector<sphere> spheres;
+    spheres.reserve(count);
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        point3 const center{random_double(rng, -2.0, 2.0), random_double(rng, -1.2, 1.2), random_double(rng, -3.0, 0.0)};
+        spheres.emplace_back(center, random_double(rng, 0.005, 0.02), material);
+    }
+
+    s.spheres = std::make_shared<sphere_set>(std::move(spheres));
+
+    return s;
+}
+
+/**
+ * @brief Small triangles scattered in front of the camera, always the same ones, in one indexed mesh.
+ */
+auto triangle_field(uint32_t count) -> scene
+{
+    scene s;
+    s.lights.emplace_back(light{vec3{0.0, 2.0, 2.0}, color{1.0, 1.0, 1.0}, 10.0});
+    material_description diffuse;
+    diffuse.kind = material_kind::lambertian;
+    diffuse.albedo = color{0.3, 0.3, 0.8};
+    s.material_descriptions.push_back(diffuse);
+    s.materials = make_materials(s.material_descriptions);
+
+    sampler rng(2);
+    indexed_mesh data;
+    data.vertices.reserve(static_cast<std::size_t>(count) * 3);
+    data.faces.reserve(count);
+
+    for (uint32_t k = 0; k < count; ++k)
+    {
+        point3 const center{random_double(rng, -2.0, 2.0), random_double(rng, -1.2, 1.2), random_double(rng, -3.0, 0.0)};
+
+        for (int v = 0; v < 3; ++v)
+        {
+            data.vertices.push_back(center + 0.03 * vec3{random_double(rng, -1.0, 1.0), random_double(rng, -1.0, 1.0),
+                                                         random_double(rng, -1.0, 1.0)});
+        }
+
+        data.faces.push_back({3 * k, 3 * k + 1, 3 * k + 2});
+    }
+
+    s.meshes.push_back(std::make_shared<mesh>(std::make_shared<indexed_mesh const>(std::move(data)), material_id{0}));
+
+    return s;
+}
+
+/**
+ * @brief Builds the scene and its hierarchy, renders it and encodes the image, timing each stage.
+ */
+auto run(benchmark_case const& entry, camera& view, std::size_t thread_count) -> benchmark_result
+{
+    benchmark_result result;
+    result.name = entry.name;
+    stage_timer build_timer;
+    auto const s = entry.build();
+    auto const world = s.world();
+    build_timer.lap(result.build);
+    result.primitives = primitive_count(s);
+
+    auto const image = view.render(world, s.materials, s.lights, render_mode::final, thread_count);
+    result.render = view.stats();
+
+    stage_timer encode_timer;
+    std::ostringstream encoded;
+    write_image(image, encoded, image_format::ppm);
+    encode_timer.lap(result.encode);
+
+    return result;
+}
+
+auto write_table(std::span<benchmark_result const> results) -> void
+{
+    auto const seconds = [](std::chrono::nanoseconds const time) { return std::chrono::duration<double>(time).count(); };
+
+    std::cout << std::format("{:<16}{:>10}{:>10}{:>10}{:>10}{:>8}{:>8}{:>11}{:>10}{:>10}{:>10}\n", "scene", "prims",
+                             "build s", "render s", "Mrays/s", "util", "imbal", "intersect", "shade", "shadow", "encode s");
+
+    for (auto const& r : results)
+    {
+        auto const total = r.render.total();
+        std::cout << std::format("{:<16}{:>10}{:>10.3f}{:>10.3f}{:>10.2f}{:>8.2f}{:>8.2f}{:>11.3f}{:>10.3f}{:>10.3f}{:>10.4f}\n",
+                                 r.name, r.primitives, seconds(r.build), seconds(r.render.wall), r.render.mrays_per_second(),
+                                 r.render.utilization(), r.render.imbalance(), seconds(total.intersect),
+                                 seconds(total.shade), seconds(total.shadow), seconds(r.encode));
+    }
+}
+
+auto write_json(std::span<benchmark_result const> results) -> void
+{
+    auto const seconds = [](std::chrono::nanoseconds const time) { return std::chrono::duration<double>(time).count(); };
+
+    std::cout << "[";
+
+    for (std::size_t k = 0; k < results.size(); ++k)
+    {
+        auto const& r = results[k];
+        std::cout << (k == 0 ? "\n" : ",\n") << "{\"scene\": \"" << r.name << "\", \"primitives\": " << r.primitives
+                  << ", \"build\": " << seconds(r.build) << ", \"encode\": " << seconds(r.encode) << ", \"render\": ";
+        r.render.write_json(std::cout);
+        std::cout << '}';
+    }
+
+    std::cout << "\n]\n";
+}
+
+/**
+ * @brief Renders the reference scenes and reports their throughput and stage timings.
+ * Usage: benchmark [--json] [--threads N] [--samples N] [--width N] [--count N] [scene...]
+ */
+auto main(int argc, char* argv[]) -> int
+{
+    auto const args = std::span(argv, static_cast<std::size_t>(argc)).subspan(1);
+    auto json = false;
+    std::size_t thread_count = std::jthread::hardware_concurrency();
+    uint32_t count = 100'000;
+    std::vector<std::string_view> selected;
+
+    camera view;
+    view.aspect_ratio = 16.0 / 9.0;
+    view.image_width = 400;
+    view.samples_per_pixel = 16;
+    view.max_depth = 100;
+    view.collect_stats = true;
+
+    try
+    {
+        for (std::size_t k = 0; k < args.size(); ++k)
+        {
+            std::string_view const arg = args[k];
+            auto const value = [&args, &k, arg] {
+                if (++k == args.size()) { throw std::invalid_argument(std::format("{} expects a value", arg)); }
+
+                std::string_view const text = args[k];
+                uint32_t result{0};
+                auto const [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), result);
+
+                if (ec != std::errc() || ptr != text.data() + text.size() || result == 0)
+                {
+                    throw std::invalid_argument(std::format("{} expects a positive integer, not '{}'", arg, text));
+                }
+
+                return result;
+            };
+
+            if (arg == "--json") { json = true; }
+            else if (arg == "--threads") { thread_count = value(); }
+            else if (arg == "--samples") { view.samples_per_pixel = value(); }
+            else if (arg == "--width") { view.image_width = value(); }
+            else if (arg == "--count") { count = value(); }
+            else { selected.push_back(arg); }
+        }
+    }
+    catch (std::logic_error const& error)
+    {
+        std::cerr << "benchmark: " << error.what() << '\n';
+        return 1;
+    }
+
+    std::vector<benchmark_case> const cases{
+        {"four_spheres", [] { return scene_file("four_spheres.scene"); }},
+        {"test_mesh", [] { return scene_file("test_mesh.scene"); }},
+        {"sphere_field", [count] { return sphere_field(count); }},
+        {"triangle_field", [count] { return triangle_field(count); }},
+    };
+
+    for (auto const name : selected)
+    {
+        if (std::ranges::find(cases, name, &benchmark_case::name) == cases.end())
+        {
+            std::cerr << "benchmark: unknown scene '" << name << "', expected one of:";
+
+            for (auto const& entry : cases) { std::cerr << ' ' << entry.name; }
+
+            std::cerr << '\n';
+            return 1;
+        }
+    }
+
+    std::vector<benchmark_result> results;
+
+    for (auto const& entry : cases)
+    {
+        if (selected.empty() || std::ranges::find(selected, entry.name) != selected.end())
+        {
+            results.push_back(run(entry, view, thread_count));
+        }
+    }
+
+    if (json) { write_json(results); }
+    else { write_table(results); }
+
+    return 0;
+}
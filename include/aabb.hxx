@@ -0,0 +1,135 @@
+#pragma once
+
+#include "interval.hxx" // interval
+#include "ray.hxx"      // ray, point3
+#include "simd.hxx"     // double4, vec3x4
+#include "vec3.hxx"     // vec3
+
+#include <algorithm> // std::min, std::max
+#include <cstdint>   // uint32_t
+
+class aabb
+{
+public:
+
+    constexpr aabb() = default;
+
+    constexpr aabb(interval const& ix, interval const& iy, interval const& iz) : x(ix), y(iy), z(iz) {}
+
+    constexpr aabb(point3 const& a, point3 const& b)
+        : x(std::min(a[0], b[0]), std::max(a[0], b[0])), y(std::min(a[1], b[1]), std::max(a[1], b[1])),
+          z(std::min(a[2], b[2]), std::max(a[2], b[2]))
+    {}
+
+    constexpr aabb(aabb const& a, aabb const& b) : x(a.x, b.x), y(a.y, b.y), z(a.z, b.z) {}
+
+    constexpr auto axis(uint32_t n) const -> interval const&
+    {
+        if (n == 1) { return y; }
+        if (n == 2) { return z; }
+        return x;
+    }
+
+    constexpr auto is_empty() const -> bool { return x.min > x.max || y.min > y.max || z.min > z.max; }
+
+    constexpr auto centroid() const -> point3 { return {x.center(), y.center(), z.center()}; }
+
+    constexpr auto extent() const -> vec3 { return {x.size(), y.size(), z.size()}; }
+
+    constexpr auto surface_area() const -> double
+    {
+        if (is_empty()) { return 0.0; }
+        auto const [dx, dy, dz] = extent().e;
+
+        return 2.0 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    constexpr auto longest_axis() const -> uint32_t
+    {
+        auto const [dx, dy, dz] = extent().e;
+
+        if (dx > dy) { return dx > dz ? 0U : 2U; }
+        return dy > dz ? 1U : 2U;
+    }
+
+    /**
+     * @brief Slab test against the box.
+     * @param r            The ray to test.
+     * @param inv_dir      The component-wise inverse of the ray direction.
+     * @param ray_interval The parametric range to test, typically [t_min, closest_so_far].
+     * @return True if the ray overlaps the box within the given range.
+     */
+    constexpr auto hit(ray const& r, vec3 const& inv_dir, interval ray_interval) const -> bool
+    {
+        auto const origin = r.origin();
+        auto const slab = [&ray_interval](interval const& bounds, double o, double inv) {
+            auto const t0 = (bounds.min - o) * inv;
+            auto const t1 = (bounds.max - o) * inv;
+            auto const near = inv < 0.0 ? t1 : t0;
+            auto const far = inv < 0.0 ? t0 : t1;
+            ray_interval.min = near > ray_interval.min ? near : ray_interval.min;
+            ray_interval.max = far < ray_interval.max ? far : ray_interval.max;
+
+            return ray_interval.min <= ray_interval.max;
+        };
+
+        return slab(x, origin.x(), inv_dir.x()) && slab(y, origin.y(), inv_dir.y()) && slab(z, origin.z(), inv_dir.z());
+    }
+
+    /**
+     * @brief Slab test of four rays at once, lane for lane the same answer as the scalar test. A ray starting on a slab
+     * plane and parallel to it gets a NaN distance there, which min and max pass over in favour of their second
+     * argument, the current range, exactly as the comparisons of the scalar test do.
+     * @param origin  The ray origins.
+     * @param inv_dir The component-wise inverses of the ray directions.
+     * @param t_min   The start of the parametric range of each ray.
+     * @param t_max   The end of the parametric range of each ray.
+     * @return The mask of the rays overlapping the box, ray 0 in bit 0.
+     */
+    auto hit(vec3x4 const& origin, vec3x4 const& inv_dir, double4 const& t_min, double4 const& t_max) const -> uint32_t
+    {
+        auto const slab = [](interval const& i, double4 const& o, double4 const& inv, double4& near, double4& far) {
+            auto const t0 = (double4(i.min) - o) * inv;
+            auto const t1 = (double4(i.max) - o) * inv;
+            auto const negative = inv < double4(0.0);
+            near = max(select(negative, t1, t0), near);
+            far = min(select(negative, t0, t1), far);
+        };
+
+        auto near = t_min;
+        auto far = t_max;
+        slab(x, origin.x, inv_dir.x, near, far);
+        slab(y, origin.y, inv_dir.y, near, far);
+        slab(z, origin.z, inv_dir.z, near, far);
+
+        return (near <= far).mask();
+    }
+
+    /**
+     * @brief Returns a copy of the box where no side is thinner than the given delta.
+     * @note  Axis-aligned triangles have flat boxes, which the slab test can miss.
+     *
+     * @param delta The minimum thickness of each side.
+     * @return The padded box.
+     */
+    constexpr auto pad(double delta = 0.0001) const -> aabb
+    {
+        auto const widen = [delta](interval const& i) { return i.size() >= delta ? i : i.expand(delta); };
+
+        return {widen(x), widen(y), widen(z)};
+    }
+
+    interval x{empty};
+    interval y{empty};
+    interval z{empty};
+};
+
+/**
+ * @brief Computes the component-wise inverse of a ray direction, as used by aabb::hit.
+ * @param direction The ray direction.
+ * @return The inverse direction.
+ */
+constexpr auto inverse_direction(vec3 const& direction) -> vec3
+{
+    return {1.0 / direction.x(), 1.0 / direction.y(), 1.0 / direction.z()};
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "color.hxx"       // color, luminance
+#include "constants.hxx"   // infinity
+#include "framebuffer.hxx" // framebuffer
+
+#include <algorithm> // std::max, std::ranges::count_if
+#include <cmath>     // std::sqrt
+#include <cstddef>   // std::size_t
+#include <cstdint>   // uint32_t
+#include <vector>    // std::vector
+
+/**
+ * @brief Running sums of the samples of one pixel, enough to get their mean and the variance of their luminance.
+ */
+struct pixel_estimate
+{
+    color sum;
+    double luminance_sum{0.0};
+    double luminance_square_sum{0.0};
+    uint32_t samples{0};
+    bool below_threshold{false};
+    bool converged{false};
+
+    constexpr auto add(color const& sample) -> void
+    {
+        auto const y = luminance(sample);
+        sum += sample;
+        luminance_sum += y;
+        luminance_square_sum += y * y;
+        ++samples;
+    }
+
+    constexpr auto mean() const -> color { return samples == 0 ? color{} : sum / samples; }
+
+    /**
+     * @brief The standard error of the mean luminance, relative to that mean, infinite below two samples.
+     * The mean is floored so that the noise of almost black pixels is not blown out of proportion.
+     */
+    auto relative_error() const -> double
+    {
+        if (samples < 2) { return infinity; }
+
+        auto const n = static_cast<double>(samples);
+        auto const mean_luminance = luminance_sum / n;
+        auto const variance = std::max(0.0, (luminance_square_sum - mean_luminance * luminance_sum) / (n - 1.0));
+
+        return std::sqrt(variance / n) / std::max(mean_luminance, dark_luminance);
+    }
+
+    /**
+     * @brief Called at the end of each pass that sampled the pixel. The pixel converges once its error is below the
+     * threshold at the end of two of its passes in a row, both with at least min_samples samples, so that a few samples
+     * agreeing by chance within one pass never stop it.
+     */
+    auto end_pass(double const threshold, uint32_t const min_samples) -> void
+    {
+        auto const below = samples >= std::max(min_samples, 2U) && relative_error() < threshold;
+        converged = below && below_threshold;
+        below_threshold = below;
+    }
+
+    static constexpr double dark_luminance{1.0 / 256.0};
+};
+
+/**
+ * @brief The estimates of all the pixels of an image, kept across the passes of an adaptive render.
+ */
+class accumulation_buffer
+{
+public:
+
+    accumulation_buffer(uint32_t width, uint32_t height)
+        : m_width(width), m_height(height), m_pixels(static_cast<std::size_t>(width) * height)
+    {}
+
+    auto at(uint32_t i, uint32_t j) -> pixel_estimate& { return m_pixels[static_cast<std::size_t>(j) * m_width + i]; }
+
+    auto at(uint32_t i, uint32_t j) const -> pixel_estimate const&
+    {
+        return m_pixels[static_cast<std::size_t>(j) * m_width + i];
+    }
+
+    auto pixel_count() const -> std::size_t { return m_pixels.size(); }
+
+    auto converged_count() const -> std::size_t
+    {
+        return static_cast<std::size_t>(std::ranges::count_if(m_pixels, &pixel_estimate::converged));
+    }
+
+    /**
+     * @brief Writes the current mean of every pixel into the image, which must have the same size.
+     */
+    auto resolve(framebuffer& image) const -> void
+    {
+        for (uint32_t j = 0; j < m_height; ++j)
+        {
+            for (uint32_t i = 0; i < m_width; ++i) { image.set(i, j, at(i, j).mean()); }
+        }
+    }
+
+private:
+
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<pixel_estimate> m_pixels;
+};
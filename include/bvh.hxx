@@ -0,0 +1,428 @@
+#pragma once
+
+#include "aabb.hxx"          // aabb, inverse_direction
+#include "hittable.hxx"      // hittable, hit_record
+#include "hittable_list.hxx" // hittable_list
+#include "ray_packet.hxx"    // ray_packet
+#include "simd.hxx"          // double4, vec3x4
+
+#include <algorithm> // std::ranges::transform, std::ranges::any_of, std::nth_element, std::partition
+#include <array>     // std::array
+#include <bit>       // std::countr_zero
+#include <cstdint>   // uint32_t
+#include <memory>    // std::shared_ptr
+#include <numeric>   // std::iota
+#include <ranges>    // std::views::iota
+#include <span>      // std::span
+#include <utility>   // std::pair
+#include <vector>    // std::vector
+
+struct bvh_node
+{
+    aabb box;
+    uint32_t offset{0}; // Interior nodes: index of the right child, the left one follows the node. Leaves: first primitive.
+    uint32_t count{0};  // Number of primitives in a leaf, zero for interior nodes.
+    uint32_t axis{0};   // Split axis, used to visit the nearest child first.
+};
+
+/**
+ * @brief Flattened bounding volume hierarchy built with a binned surface area heuristic.
+ * The tree only knows about primitive boxes, callers intersect the primitives of each leaf
+ * themselves in the order given by indices().
+ */
+class bvh_tree
+{
+public:
+
+    static constexpr uint32_t bin_count{16};
+    static constexpr uint32_t max_depth{64};
+    static constexpr uint32_t invalid_index{~0U};
+
+    bvh_tree() = default;
+
+    explicit bvh_tree(std::span<aabb const> boxes, uint32_t max_leaf_size = 4)
+    {
+        if (boxes.empty()) { return; }
+
+        std::vector<point3> centroids(boxes.size());
+        std::ranges::transform(boxes, centroids.begin(), [](aabb const& box) { return box.centroid(); });
+        m_indices.resize(boxes.size());
+        std::iota(m_indices.begin(), m_indices.end(), 0U);
+        auto const leaf_size = std::max(max_leaf_size, 1U);
+        m_nodes.reserve(2 * boxes.size() / leaf_size + 1);
+        build(boxes, centroids, 0, static_cast<uint32_t>(boxes.size()), leaf_size, 0);
+    }
+
+    /**
+     * @brief Restores a tree from the nodes() and indices() of one built before.
+     */
+    bvh_tree(std::vector<bvh_node> nodes, std::vector<uint32_t> indices)
+        : m_nodes(std::move(nodes)), m_indices(std::move(indices))
+    {}
+
+    auto empty() const -> bool { return m_nodes.empty(); }
+
+    auto bounding_box() const -> aabb { return m_nodes.empty() ? aabb{} : m_nodes.front().box; }
+
+    auto nodes() const -> std::span<bvh_node const> { return m_nodes; }
+
+    /**
+     * @brief The primitive order of the leaves: leaf primitive k is the input primitive indices()[k].
+     */
+    auto indices() const -> std::span<uint32_t const> { return m_indices; }
+
+    /**
+     * @brief Finds the closest intersection, visiting the nearest child first.
+     * @param r            The ray to trace.
+     * @param ray_interval The parametric range to search.
+     * @param leaf         Called as leaf(first, count, ray_interval) for each leaf the ray reaches. It must return
+     *                     true on a hit and shrink ray_interval.max to the distance of that hit.
+     * @return True if any leaf reported a hit.
+     */
+    template <typename Leaf>
+    auto closest_hit(ray const& r, interval ray_interval, Leaf&& leaf) const -> bool
+    {
+        if (m_nodes.empty()) [[unlikely]] { return false; }
+
+        auto const inv_dir = inverse_direction(r.direction());
+        std::array<bool, 3> const negative{inv_dir.x() < 0.0, inv_dir.y() < 0.0, inv_dir.z() < 0.0};
+        std::array<uint32_t, max_depth> stack{};
+        uint32_t top{0};
+        uint32_t current{0};
+        bool hit_anything = false;
+
+        for (;;)
+        {
+            auto const& node = m_nodes[current];
+
+            if (node.box.hit(r, inv_dir, ray_interval))
+            {
+                if (node.count == 0)
+                {
+                    auto const near_right = negative[node.axis];
+                    stack[top++] = near_right ? current + 1 : node.offset;
+                    current = near_right ? node.offset : current + 1;
+                    continue;
+                }
+
+                hit_anything |= leaf(node.offset, node.count, ray_interval);
+            }
+
+            if (top == 0) { break; }
+            current = stack[--top];
+        }
+
+        return hit_anything;
+    }
+
+    /**
+     * @brief Packet version of closest_hit: a node is visited when any active ray of the packet overlaps it,
+     * nearest child first according to the first of them.
+     * @param packet The rays to trace, see ray_packet.
+     * @param leaf   Called as leaf(first, count) for each leaf, with packet.active narrowed to the rays overlapping it.
+     */
+    template <typename Leaf>
+    auto closest_hit(ray_packet& packet, Leaf&& leaf) const -> void
+    {
+        if (m_nodes.empty() || packet.active == 0) [[unlikely]] { return; }
+
+        auto const active = packet.active;
+        auto const origin = packet.origins();
+        auto const inv_dir = packet.inverse_directions();
+        auto const leader = static_cast<uint32_t>(std::countr_zero(active));
+        auto const leader_dir = packet.rays[leader].direction();
+        std::array<bool, 3> const negative{leader_dir.x() < 0.0, leader_dir.y() < 0.0, leader_dir.z() < 0.0};
+        std::array<uint32_t, max_depth> stack{};
+        uint32_t top{0};
+        uint32_t current{0};
+
+        for (;;)
+        {
+            auto const& node = m_nodes[current];
+            auto const lanes = node.box.hit(origin, inv_dir, packet.range_min(), packet.range_max()) & active;
+
+            if (lanes != 0)
+            {
+                if (node.count == 0)
+                {
+                    auto const near_right = negative[node.axis];
+                    stack[top++] = near_right ? current + 1 : node.offset;
+                    current = near_right ? node.offset : current + 1;
+                    continue;
+                }
+
+                packet.active = lanes;
+                leaf(node.offset, node.count);
+                packet.active = active;
+            }
+
+            if (top == 0) { break; }
+            current = stack[--top];
+        }
+    }
+
+    /**
+     * @brief Moves every leaf to a multiple of width in indices(), padding the gaps with invalid_index.
+     * Leaves never hold more than the max_leaf_size given at construction, so with a width of at least that
+     * size each leaf fits in one block of width primitives, found at offset / width.
+     */
+    auto align_leaves(uint32_t width) -> void
+    {
+        std::vector<uint32_t> aligned;
+        aligned.reserve(m_indices.size() + m_indices.size() / 2);
+
+        for (auto& node : m_nodes)
+        {
+            if (node.count == 0) { continue; }
+
+            auto const first = static_cast<uint32_t>(aligned.size());
+            auto const leaf = std::span(m_indices).subspan(node.offset, node.count);
+            aligned.insert(aligned.end(), leaf.begin(), leaf.end());
+            aligned.resize(first + ((node.count + width - 1) / width) * width, invalid_index);
+            node.offset = first;
+        }
+
+        m_indices = std::move(aligned);
+    }
+
+    /**
+     * @brief Early-exit traversal for occlusion queries.
+     * @param r            The ray to trace.
+     * @param ray_interval The parametric range to search.
+     * @param leaf         Called as leaf(first, count, ray_interval) for each leaf the ray reaches, returns true on a hit.
+     * @return True as soon as a leaf reports a hit.
+     */
+    template <typename Leaf>
+    auto any_hit(ray const& r, interval const& ray_interval, Leaf&& leaf) const -> bool
+    {
+        if (m_nodes.empty()) [[unlikely]] { return false; }
+
+        auto const inv_dir = inverse_direction(r.direction());
+        std::array<uint32_t, max_depth> stack{};
+        uint32_t top{0};
+        uint32_t current{0};
+
+        for (;;)
+        {
+            auto const& node = m_nodes[current];
+
+            if (node.box.hit(r, inv_dir, ray_interval))
+            {
+                if (node.count == 0)
+                {
+                    stack[top++] = node.offset;
+                    current = current + 1;
+                    continue;
+                }
+
+                if (leaf(node.offset, node.count, ray_interval)) { return true; }
+            }
+
+            if (top == 0) { break; }
+            current = stack[--top];
+        }
+
+        return false;
+    }
+
+private:
+
+    struct bin
+    {
+        aabb box;
+        uint32_t count{0};
+    };
+
+    auto build(std::span<aabb const> boxes, std::span<point3 const> centroids, uint32_t begin, uint32_t end,
+               uint32_t max_leaf_size, uint32_t depth) -> uint32_t
+    {
+        auto const node_index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+
+        aabb bounds;
+        aabb centroid_bounds;
+
+        for (auto const i : std::views::iota(begin, end))
+        {
+            bounds = aabb(bounds, boxes[m_indices[i]]);
+            centroid_bounds = aabb(centroid_bounds, aabb(centroids[m_indices[i]], centroids[m_indices[i]]));
+        }
+
+        m_nodes[node_index].box = bounds;
+        auto const count = end - begin;
+
+        if (count <= max_leaf_size)
+        {
+            m_nodes[node_index].offset = begin;
+            m_nodes[node_index].count = count;
+
+            return node_index;
+        }
+
+        auto const first = m_indices.begin() + begin;
+        auto const last = m_indices.begin() + end;
+        auto axis = centroid_bounds.longest_axis();
+        auto mid = first;
+
+        // Past this depth the heuristic is ignored so that the traversal stack can never overflow.
+        if (depth + 32 < max_depth)
+        {
+            auto const [best_axis, best_bin] = find_split(boxes, centroids, centroid_bounds, begin, end);
+
+            if (best_bin < bin_count)
+            {
+                axis = best_axis;
+                auto const& slab = centroid_bounds.axis(axis);
+                auto const scale = bin_count / slab.size();
+                mid = std::partition(first, last, [&](uint32_t const idx) {
+                    return bin_index(centroids[idx][static_cast<int>(axis)], slab.min, scale) <= best_bin;
+                });
+            }
+        }
+
+        if (mid == first || mid == last)
+        {
+            mid = first + count / 2;
+            std::nth_element(first, mid, last, [&](uint32_t const a, uint32_t const b) {
+                return centroids[a][static_cast<int>(axis)] < centroids[b][static_cast<int>(axis)];
+            });
+        }
+
+        auto const split = static_cast<uint32_t>(mid - m_indices.begin());
+        build(boxes, centroids, begin, split, max_leaf_size, depth + 1);
+        auto const right = build(boxes, centroids, split, end, max_leaf_size, depth + 1);
+        m_nodes[node_index].offset = right;
+        m_nodes[node_index].axis = axis;
+
+        return node_index;
+    }
+
+    /**
+     * @brief Bins the centroids along each axis and returns the cheapest split according to the SAH.
+     * @return The split axis and the last bin of the left side, or bin_count if no split is possible.
+     */
+    auto find_split(std::span<aabb const> boxes, std::span<point3 const> centroids, aabb const& centroid_bounds,
+                    uint32_t begin, uint32_t end) const -> std::pair<uint32_t, uint32_t>
+    {
+        std::pair<uint32_t, uint32_t> best{0, bin_count};
+        auto best_cost = infinity;
+
+        for (auto const axis : {0U, 1U, 2U})
+        {
+            auto const& slab = centroid_bounds.axis(axis);
+
+            if (slab.size() <= 0.0) { continue; }
+
+            std::array<bin, bin_count> bins{};
+            auto const scale = bin_count / slab.size();
+
+            for (auto const i : std::views::iota(begin, end))
+            {
+                auto const idx = m_indices[i];
+                auto& b = bins[bin_index(centroids[idx][static_cast<int>(axis)], slab.min, scale)];
+                b.box = aabb(b.box, boxes[idx]);
+                ++b.count;
+            }
+
+            std::array<double, bin_count - 1> left_cost{};
+            std::array<uint32_t, bin_count - 1> left_count{};
+            aabb left_box;
+            uint32_t running_count{0};
+
+            for (auto const b : std::views::iota(0U, bin_count - 1))
+            {
+                left_box = aabb(left_box, bins[b].box);
+                running_count += bins[b].count;
+                left_count[b] = running_count;
+                left_cost[b] = running_count * left_box.surface_area();
+            }
+
+            aabb right_box;
+            uint32_t right_count{0};
+
+            for (auto b = bin_count - 1; b > 0; --b)
+            {
+                right_box = aabb(right_box, bins[b].box);
+                right_count += bins[b].count;
+
+                if (left_count[b - 1] == 0 || right_count == 0) { continue; }
+
+                auto const cost = left_cost[b - 1] + right_count * right_box.surface_area();
+
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best = {axis, b - 1};
+                }
+            }
+        }
+
+        return best;
+    }
+
+    static constexpr auto bin_index(double value, double min, double scale) -> uint32_t
+    {
+        auto const b = static_cast<uint32_t>((value - min) * scale);
+
+        return b < bin_count ? b : bin_count - 1;
+    }
+
+    std::vector<bvh_node> m_nodes;
+    std::vector<uint32_t> m_indices;
+};
+
+class bvh : public hittable
+{
+public:
+
+    explicit bvh(hittable_list const& list) : bvh(list.objects()) {}
+
+    explicit bvh(std::span<std::shared_ptr<hittable> const> objects)
+    {
+        std::vector<aabb> boxes(objects.size());
+        std::ranges::transform(objects, boxes.begin(), [](auto const& object) { return object->bounding_box(); });
+        m_tree = bvh_tree(boxes, 1);
+        m_objects.reserve(objects.size());
+        std::ranges::for_each(m_tree.indices(), [this, objects](uint32_t const idx) { m_objects.push_back(objects[idx]); });
+    }
+
+    auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
+    {
+        return m_tree.closest_hit(r, ray_interval, [this, &r, &rec](uint32_t first, uint32_t count, interval& range) {
+            bool hit_anything = false;
+
+            for (auto const k : std::views::iota(first, first + count))
+            {
+                if (m_objects[k]->hit(r, range, rec))
+                {
+                    hit_anything = true;
+                    range.max = rec.t;
+                }
+            }
+
+            return hit_anything;
+        });
+    }
+
+    auto any_hit(ray const& r, interval ray_interval) const -> bool override
+    {
+        return m_tree.any_hit(r, ray_interval, [this, &r](uint32_t first, uint32_t count, interval const& range) {
+            return std::ranges::any_of(std::views::iota(first, first + count),
+                                       [this, &r, &range](uint32_t const k) { return m_objects[k]->any_hit(r, range); });
+        });
+    }
+
+    auto hit_packet(ray_packet& packet) const -> void override
+    {
+        m_tree.closest_hit(packet, [this, &packet](uint32_t first, uint32_t count) {
+            for (auto const k : std::views::iota(first, first + count)) { m_objects[k]->hit_packet(packet); }
+        });
+    }
+
+    auto bounding_box() const -> aabb override { return m_tree.bounding_box(); }
+
+private:
+
+    bvh_tree m_tree;
+    std::vector<std::shared_ptr<hittable>> m_objects;
+};
@@ -1,20 +1,29 @@
 #pragma once
 
-#include "color.hxx"    // color
-#include "helpers.hxx"  // random_double
-#include "hittable.hxx" // hittable
-#include "light.hxx"    // light
-#include "material.hxx" // material
-#include "vec3.hxx"     // vec3
-
+#include "accumulation_buffer.hxx" // accumulation_buffer, pixel_estimate
+#include "color.hxx"               // color
+#include "framebuffer.hxx"         // framebuffer
+#include "helpers.hxx"             // random_double, sampler
+#include "hittable.hxx"            // hittable
+#include "light.hxx"               // light
+#include "material.hxx"            // material_table
+#include "ray_packet.hxx"          // ray_packet
+#include "render_stats.hxx"        // render_stats, stage_timer, thread_stats
+#include "simd.hxx"                // for_each_lane
+#include "vec3.hxx"                // vec3
+
+#include <algorithm>  // std::min, std::ranges::generate_n
+#include <atomic>     // std::atomic
+#include <bit>        // std::popcount
+#include <chrono>     // std::chrono::milliseconds, std::chrono::steady_clock
 #include <cstdint>    // uint32_t
-#include <format>     // std::format
-#include <iostream>   // std::clog, std::cout, std::flush
-#include <latch>      // std::latch
-#include <numeric>    // std::transform_reduce
+#include <functional> // std::function
+#include <iostream>   // std::clog, std::flush
+#include <iterator>   // std::back_inserter
+#include <optional>   // std::optional
 #include <ranges>     // std::views::iota
-#include <syncstream> // std::osyncstream
-#include <thread>     // std::thread
+#include <thread>     // std::jthread
+#include <vector>     // std::vector
 
 enum class render_mode
 {
@@ -30,25 +39,68 @@ public:
     uint32_t image_width{100};
     uint32_t samples_per_pixel{10};
     uint32_t max_depth{10};
-
-    auto render(hittable const& world, std::span<light const> lights = {}, render_mode const mode = render_mode::final,
-                size_t const thread_count = std::thread::hardware_concurrency()) -> void
+    uint64_t seed{0};
+
+    /**
+     * @brief Adaptive sampling, enabled by a non-zero samples_per_pass. The image is then rendered in passes of that many
+     * samples per pixel, up to samples_per_pixel. A pixel is no longer sampled once it has at least min_samples samples
+     * and the relative standard error of its luminance stayed below noise_threshold for two passes in a row. The render
+     * stops at the end of the pass during which time_budget runs out, a zero budget meaning no limit. Past the first
+     * pass, tiles not started before the deadline are skipped.
+     */
+    uint32_t samples_per_pass{0};
+    uint32_t min_samples{16};
+    double noise_threshold{0.01};
+    std::chrono::milliseconds time_budget{0};
+
+    /**
+     * @brief Called with the image and the index of the pass after each pass of an adaptive render, if set.
+     */
+    std::function<void(framebuffer const&, uint32_t)> on_pass;
+
+    /**
+     * @brief Counts the rays and times the stages of each thread, see stats(). Costs two clock reads per packet, and two
+     * per hit for the shadow rays.
+     */
+    bool collect_stats{false};
+
+    /**
+     * @brief Renders the world into a linear framebuffer, see image.hxx to write it.
+     */
+    auto render(hittable const& world, material_table const& materials, std::span<light const> lights = {},
+                render_mode const mode = render_mode::final,
+                size_t const thread_count = std::jthread::hardware_concurrency()) -> framebuffer
     {
         initialize();
-        std::cout << std::format("P3\n{} {}\n255\n", image_width, m_image_height);
+        framebuffer image(image_width, m_image_height);
+        render_stats stats;
+        stats.threads.resize(collect_stats ? std::max<size_t>(thread_count, 1) : 0);
+        auto const start = std::chrono::steady_clock::now();
 
-        switch (thread_count)
+        if (samples_per_pass == 0)
         {
-        case 0:
-        case 1:
-            singlethreaded_render(world, lights, mode);
-            break;
-        default:
-            multithreaded_render(world, lights, mode, thread_count);
-            break;
+            for_each_tile(thread_count, [&](uint32_t const tile, uint32_t const worker) {
+                render_tile(stats, tile, worker, [&](uint32_t const i, uint32_t const j, thread_stats* const counters) {
+                    pixel_estimate estimate;
+                    sample_pixel(world, materials, lights, mode, i, j, 0, samples_per_pixel, estimate, counters);
+                    image.set(i, j, estimate.mean());
+                });
+            });
         }
+        else { adaptive_render(world, materials, lights, mode, thread_count, image, stats); }
+
+        stats.wall = std::chrono::steady_clock::now() - start;
+        m_stats = std::move(stats);
+        std::clog << "Done.\n";
+
+        return image;
     }
 
+    /**
+     * @brief The statistics of the last render, without any thread unless collect_stats was set.
+     */
+    auto stats() const -> render_stats const& { return m_stats; }
+
 private:
 
     constexpr auto initialize() -> void
@@ -76,9 +128,9 @@ private:
         m_lower_left_corner = viewport_upper_left + 0.5 * (pixel_delta_u + pixel_delta_v);
     }
 
-    auto get_ray(uint32_t i, uint32_t j) const -> ray
+    auto get_ray(uint32_t i, uint32_t j, sampler& rng) const -> ray
     {
-        auto const pixel_offset = pixel_sample_square();
+        auto const pixel_offset = pixel_sample_square(rng);
         auto const horizontal_offset = (i + pixel_offset.x()) / (image_width - 1);
         auto const vertical_offset = (j + pixel_offset.y()) / (m_image_height - 1);
         auto const direction = m_lower_left_corner + horizontal_offset * m_horizontal + vertical_offset * m_vertical - m_origin;
@@ -86,124 +138,297 @@ private:
         return {m_origin, direction};
     }
 
-    auto pixel_sample_square() const -> vec3
+    auto pixel_sample_square(sampler& rng) const -> vec3
     {
-        auto const x = -0.5 + random_double();
-        auto const y = -0.5 + random_double();
+        auto const x = -0.5 + random_double(rng);
+        auto const y = -0.5 + random_double(rng);
 
         return (x * m_horizontal) + (y * m_vertical);
     }
 
     static auto is_shadowed(vec3 const& point, vec3 const& to_light, double light_distance, hittable const& world) -> bool
     {
-        ray shadow_ray(point, to_light);
-        hit_record shadow_rec;
+        ray const shadow_ray(point, to_light);
 
-        return world.hit(shadow_ray, {0.001, light_distance}, shadow_rec);
+        return world.any_hit(shadow_ray, {0.001, light_distance});
     }
 
-    static auto ray_color(ray const& r, uint32_t depth, hittable const& world, std::span<light const> lights,
-                          render_mode const mode) -> color
+    /**
+     * @brief The direct light at a hit. With counters, the light loop is timed as the shadow stage and its rays counted.
+     */
+    static auto shade(hit_record const& rec, hittable const& world, material_table const& materials,
+                      std::span<light const> lights, render_mode const mode, thread_stats* const counters) -> color
     {
-        if (depth <= 0) [[unlikely]] { return {}; }
+        auto const albedo = materials[rec.mat_id].get_color();
+        color diffuse_light;
+        std::optional<stage_timer> shadow_timer;
 
-        hit_record rec;
+        if (counters != nullptr) { shadow_timer.emplace(); }
 
-        if (world.hit(r, interval{0.001, infinity}, rec))
+        for (auto const& source : lights)
         {
-            color diffuse_light;
+            auto const to_light = source.position - rec.p;
+            auto const light_distance = to_light.length();
+            auto const light_direction = to_light / light_distance;
 
-            for (auto const& source : lights)
+            if (!is_shadowed(rec.p, light_direction, light_distance, world))
             {
-                auto const to_light = source.position - rec.p;
-                auto const light_distance = to_light.length();
-                auto const light_direction = to_light / light_distance;
-
-                if (!is_shadowed(rec.p, light_direction, light_distance, world))
-                {
-                    auto const light_intensity = source.intensity / (light_distance * light_distance);
-                    auto const light_attenuation = std::max(0.0, dot(rec.normal, light_direction));
-                    diffuse_light += light_attenuation * source.color * light_intensity * rec.mat_ptr->get_color();
-                }
+                auto const light_intensity = source.intensity / (light_distance * light_distance);
+                auto const light_attenuation = std::max(0.0, dot(rec.normal, light_direction));
+                diffuse_light += light_attenuation * source.color * light_intensity * albedo;
             }
+        }
 
-            if (mode == render_mode::normals) { return 0.5 * (rec.normal + color(1.0, 1.0, 1.0)); }
-
-            return diffuse_light;
+        if (shadow_timer)
+        {
+            shadow_timer->lap(counters->shadow);
+            counters->shadow_rays += lights.size();
         }
 
+        if (mode == render_mode::normals) { return 0.5 * (rec.normal + color(1.0, 1.0, 1.0)); }
+
+        return diffuse_light;
+    }
+
+    static auto background(ray const& r) -> color
+    {
         auto const unit_direction = unit_vector(r.direction());
         auto const t = 0.5 * (unit_direction.y() + 1.0);
 
         return (1.0 - t) * color{1.0, 1.0, 1.0} + t * color{0.5, 0.7, 1.0};
     }
 
-    auto singlethreaded_render(hittable const& world, std::span<light const> lights, render_mode const mode) -> void
+    /**
+     * @brief Builds a packet from consecutive samples of one pixel, whose rays all start at the camera and
+     * stay within the pixel footprint, hence traverse the scene together.
+     * @param i            The column of the pixel.
+     * @param j            The row of the pixel.
+     * @param first_sample The index of the first sample of the packet.
+     * @param end_sample   The index past the last sample of the pixel to take, the packet stops there.
+     * @return The packet, with one active lane per sample.
+     */
+    auto get_ray_packet(uint32_t i, uint32_t j, uint32_t first_sample, uint32_t end_sample) const -> ray_packet
+    {
+        ray_packet packet;
+        auto const pixel = j * image_width + i;
+        auto const count = std::min(ray_packet::width, end_sample - first_sample);
+        packet.active = (1U << count) - 1;
+
+        for_each_lane(packet.active, [&](uint32_t const lane) {
+            auto rng = sampler::for_sample(seed, pixel, first_sample + lane);
+            packet.rays[lane] = get_ray(i, j, rng);
+            packet.ranges[lane] = {0.001, infinity};
+        });
+
+        return packet;
+    }
+
+    /**
+     * @brief Traces the primary rays of the samples [first_sample, end_sample) of a pixel packet by packet,
+     * and adds their colors to its estimate. Each sample has its own seed, so the passes of an adaptive render
+     * take exactly the samples a single pass would.
+     */
+    auto sample_pixel(hittable const& world, material_table const& materials, std::span<light const> lights,
+                      render_mode const mode, uint32_t i, uint32_t j, uint32_t first_sample, uint32_t end_sample,
+                      pixel_estimate& estimate, thread_stats* const counters) const -> void
     {
-        for (auto const j : std::views::iota(0U, m_image_height))
+        if (max_depth == 0) [[unlikely]] { return; }
+
+        auto const shade_packet = [&](ray_packet const& packet) {
+            for_each_lane(packet.active, [&](uint32_t const lane) {
+                auto const hit = (packet.hits >> lane) & 1U;
+                estimate.add(hit != 0 ? shade(packet.records[lane], world, materials, lights, mode, counters)
+                                      : background(packet.rays[lane]));
+            });
+        };
+
+        for (auto sample = first_sample; sample < end_sample; sample += ray_packet::width)
         {
-            std::clog << "\rScanlines remaining: " << m_image_height - j << ' ' << std::flush;
+            auto packet = get_ray_packet(i, j, sample, end_sample);
 
-            for (auto const i : std::views::iota(0U, image_width))
+            if (counters == nullptr)
             {
-                auto const sp_range = std::views::iota(0U, samples_per_pixel);
-                auto const render = [this, &world, &lights, mode, i, j](auto const) {
-                    return ray_color(get_ray(i, j), max_depth, world, lights, mode);
-                };
-                auto const px_color = std::transform_reduce(sp_range.begin(), sp_range.end(), color{}, std::plus{}, render);
-                write_color(std::cout, px_color, samples_per_pixel);
+                world.hit_packet(packet);
+                shade_packet(packet);
+                continue;
             }
+
+            stage_timer timer;
+            world.hit_packet(packet);
+            timer.lap(counters->intersect);
+            auto const shadow = counters->shadow;
+            shade_packet(packet);
+            timer.lap(counters->shade);
+            // The shading lap spans the shadow rays, which shade() already added to their own timer.
+            counters->shade -= counters->shadow - shadow;
+            counters->primary_rays += static_cast<uint64_t>(std::popcount(packet.active));
         }
+    }
+
+    /**
+     * @brief Samples the pixels pass by pass, each pass skipping the converged ones, until all of them converge,
+     * samples_per_pixel is reached or time_budget runs out. The image holds the estimates of the last pass.
+     */
+    auto adaptive_render(hittable const& world, material_table const& materials, std::span<light const> lights,
+                         render_mode const mode, size_t const thread_count, framebuffer& image,
+                         render_stats& stats) const -> void
+    {
+        accumulation_buffer estimates(image_width, m_image_height);
+        auto const start = std::chrono::steady_clock::now();
+        auto const out_of_time = [this, start] {
+            return time_budget.count() != 0 && std::chrono::steady_clock::now() - start >= time_budget;
+        };
 
-        std::clog << "\nDone.\n";
+        for (uint32_t pass = 0, first_sample = 0; first_sample < samples_per_pixel;
+             ++pass, first_sample += std::min(samples_per_pass, samples_per_pixel - first_sample))
+        {
+            auto const end_sample = first_sample + std::min(samples_per_pass, samples_per_pixel - first_sample);
+
+            for_each_tile(thread_count, [&](uint32_t const tile, uint32_t const worker) {
+                if (pass != 0 && out_of_time()) { return; }
+
+                render_tile(stats, tile, worker, [&](uint32_t const i, uint32_t const j, thread_stats* const counters) {
+                    auto& estimate = estimates.at(i, j);
+
+                    if (estimate.converged) { return; }
+
+                    sample_pixel(world, materials, lights, mode, i, j, first_sample, end_sample, estimate, counters);
+                    estimate.end_pass(noise_threshold, min_samples);
+                });
+            });
+
+            estimates.resolve(image);
+
+            if (on_pass) { on_pass(image, pass); }
+
+            auto const converged = estimates.converged_count();
+            std::clog << "Pass " << pass + 1 << ": " << converged << '/' << estimates.pixel_count()
+                      << " pixels converged\n";
+
+            if (converged == estimates.pixel_count() || out_of_time()) { break; }
+        }
     }
 
-    auto multithreaded_render(hittable const& world, std::span<light const> lights, render_mode const mode,
-                              size_t const thread_count) -> void
+    auto tile_count() const -> uint32_t
     {
-        std::vector<std::thread> threads(thread_count);
-        std::vector<std::string> buffers(thread_count);
-        std::latch done(static_cast<ptrdiff_t>(thread_count));
-        std::size_t remaining_lines(m_image_height);
-        auto const rows = m_image_height / thread_count;
-        auto const work = [this, &world, &lights, &buffers, &done, &remaining_lines, mode](auto idx, auto start, auto end) {
-            auto& buffer = buffers[idx];
-            buffer.reserve((end - start) * image_width * 12);
+        auto const tiles_x = (image_width + tile_size - 1) / tile_size;
+        auto const tiles_y = (m_image_height + tile_size - 1) / tile_size;
 
-            for (auto const j : std::views::iota(start, end))
+        return tiles_x * tiles_y;
+    }
+
+    /**
+     * @brief Calls fn(i, j) for the pixels of a tile, row by row.
+     */
+    template <typename F>
+    auto for_each_pixel(uint32_t const tile, F const& fn) const -> void
+    {
+        auto const tiles_x = (image_width + tile_size - 1) / tile_size;
+        auto const x0 = (tile % tiles_x) * tile_size;
+        auto const y0 = (tile / tiles_x) * tile_size;
+        auto const x1 = std::min(x0 + tile_size, image_width);
+        auto const y1 = std::min(y0 + tile_size, m_image_height);
+
+        for (auto const j : std::views::iota(y0, y1))
+        {
+            for (auto const i : std::views::iota(x0, x1)) { fn(i, j); }
+        }
+    }
+
+    /**
+     * @brief Calls render_pixel(i, j, counters) for the pixels of a tile, with the counters of the worker if the
+     * statistics are collected and nullptr otherwise.
+     */
+    template <typename F>
+    auto render_tile(render_stats& stats, uint32_t const tile, uint32_t const worker, F const& render_pixel) const -> void
+    {
+        if (stats.threads.empty())
+        {
+            for_each_pixel(tile, [&](uint32_t const i, uint32_t const j) { render_pixel(i, j, nullptr); });
+            return;
+        }
+
+        auto& counters = stats.threads[worker];
+        stage_timer timer;
+        for_each_pixel(tile, [&](uint32_t const i, uint32_t const j) { render_pixel(i, j, &counters); });
+        timer.lap(counters.busy);
+        ++counters.tiles;
+    }
+
+    /**
+     * @brief Calls process_tile(tile, worker) for every tile of the image, on the calling thread or on a pool of
+     * workers numbered from 0.
+     */
+    template <typename F>
+    auto for_each_tile(size_t const thread_count, F const& process_tile) const -> void
+    {
+        switch (thread_count)
+        {
+        case 0:
+        case 1:
+            singlethreaded_render(process_tile);
+            break;
+        default:
+            multithreaded_render(thread_count, process_tile);
+            break;
+        }
+    }
+
+    template <typename F>
+    auto singlethreaded_render(F const& process_tile) const -> void
+    {
+        auto const tiles = tile_count();
+
+        for (auto const tile : std::views::iota(0U, tiles))
+        {
+            std::clog << "\rTiles remaining: " << tiles - tile << ' ' << std::flush;
+            process_tile(tile, 0U);
+        }
+
+        std::clog << '\n';
+    }
+
+    /**
+     * @brief Renders the image with a pool of workers pulling tiles from a shared counter.
+     * Small tiles keep every worker busy until the end, whatever the distribution of the scene cost over the image.
+     * The calling thread only reports the progress, woken up each time a tile is done.
+     */
+    template <typename F>
+    auto multithreaded_render(size_t const thread_count, F const& process_tile) const -> void
+    {
+        auto const tiles = tile_count();
+        std::atomic<uint32_t> next_tile{0};
+        std::atomic<uint32_t> finished_tiles{0};
+        auto const work = [&process_tile, &next_tile, &finished_tiles, tiles](uint32_t const worker) {
+            for (auto tile = next_tile.fetch_add(1, std::memory_order_relaxed); tile < tiles;
+                 tile = next_tile.fetch_add(1, std::memory_order_relaxed))
             {
-                std::osyncstream osync(std::clog);
-                osync << "\rScanlines remaining: " << --remaining_lines << ' ' << std::flush;
-
-                for (auto const i : std::views::iota(0U, image_width))
-                {
-                    auto const sp_range = std::views::iota(0U, samples_per_pixel);
-                    auto const render = [this, i, j, &world, &lights, mode](auto const) {
-                        return ray_color(get_ray(i, j), max_depth, world, lights, mode);
-                    };
-                    auto const px_color = std::transform_reduce(sp_range.begin(), sp_range.end(), color{}, std::plus{}, render);
-                    write_color(buffer, px_color, samples_per_pixel);
-                }
+                process_tile(tile, worker);
+                finished_tiles.fetch_add(1, std::memory_order_release);
+                finished_tiles.notify_one();
             }
-
-            done.count_down();
         };
 
-        for (auto const i : std::views::iota(0U, thread_count))
         {
-            auto const start = i * rows;
-            auto const end = (i == thread_count - 1) ? m_image_height : start + rows;
-            threads.emplace_back(work, i, start, end);
+            std::vector<std::jthread> threads;
+            threads.reserve(thread_count);
+            std::ranges::generate_n(std::back_inserter(threads), static_cast<std::ptrdiff_t>(thread_count),
+                                    [&work, worker = 0U]() mutable { return std::jthread(work, worker++); });
+
+            for (auto done = finished_tiles.load(std::memory_order_acquire); done < tiles;
+                 done = finished_tiles.load(std::memory_order_acquire))
+            {
+                std::clog << "\rTiles remaining: " << tiles - done << ' ' << std::flush;
+                finished_tiles.wait(done, std::memory_order_acquire);
+            }
         }
 
-        done.wait();
-        std::ranges::for_each(threads, [](auto& thread) {
-            if (thread.joinable()) [[likely]] { thread.join(); }
-        });
-        std::ranges::for_each(buffers, [](auto const& buffer) { std::cout << buffer; });
-        std::clog << "\nDone.\n";
+        std::clog << '\n';
     }
 
+    static constexpr uint32_t tile_size{16};
+
+    render_stats m_stats;
     uint32_t m_image_height{0};
     point3 m_origin;
     point3 m_lower_left_corner;
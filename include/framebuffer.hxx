@@ -0,0 +1,59 @@
+#pragma once
+
+#include "color.hxx" // color
+
+#include <cstddef> // std::size_t
+#include <cstdint> // uint32_t
+#include <span>    // std::span
+#include <vector>  // std::vector
+
+/**
+ * @brief Linear RGB image in single precision, stored row by row from the top with interleaved components.
+ */
+class framebuffer
+{
+public:
+
+    framebuffer() = default;
+
+    framebuffer(uint32_t width, uint32_t height)
+        : m_width(width), m_height(height), m_pixels(static_cast<std::size_t>(width) * height * 3, 0.0F)
+    {}
+
+    auto width() const -> uint32_t { return m_width; }
+
+    auto height() const -> uint32_t { return m_height; }
+
+    auto set(uint32_t i, uint32_t j, color const& pixel_color) -> void
+    {
+        auto const offset = (static_cast<std::size_t>(j) * m_width + i) * 3;
+        m_pixels[offset] = static_cast<float>(pixel_color.x());
+        m_pixels[offset + 1] = static_cast<float>(pixel_color.y());
+        m_pixels[offset + 2] = static_cast<float>(pixel_color.z());
+    }
+
+    auto at(uint32_t i, uint32_t j) const -> color
+    {
+        auto const offset = (static_cast<std::size_t>(j) * m_width + i) * 3;
+
+        return {m_pixels[offset], m_pixels[offset + 1], m_pixels[offset + 2]};
+    }
+
+    auto data() const -> std::span<float const> { return m_pixels; }
+
+    auto data() -> std::span<float> { return m_pixels; }
+
+    /**
+     * @brief The components of the j-th row, from the left.
+     */
+    auto row(uint32_t j) const -> std::span<float const>
+    {
+        return data().subspan(static_cast<std::size_t>(j) * m_width * 3, static_cast<std::size_t>(m_width) * 3);
+    }
+
+private:
+
+    uint32_t m_width{0};
+    uint32_t m_height{0};
+    std::vector<float> m_pixels;
+};
@@ -1,20 +1,14 @@
 #pragma once
 
 #include "constants.hxx" // pi
+#include "sampler.hxx"   // sampler
 
-#include <random> // std::mt19937, std::random_device, std::uniform_real_distribution
+#include <cmath> // std::sqrt
 
 constexpr auto degrees_to_radians(double degrees) -> double { return degrees * pi / 180.0; }
 
 inline auto linear_to_gamma(double linear_component) -> double { return std::sqrt(linear_component); }
 
-inline auto random_double() -> double
-{
-    static std::random_device rd;
-    static std::mt19937 generator(rd());
-    static std::uniform_real_distribution<> distribution(0.0, 1.0);
+constexpr auto random_double(sampler& rng) -> double { return rng.next_double(); }
 
-    return distribution(generator);
-}
-
-inline auto random_double(double min, double max) -> double { return min + (max - min) * random_double(); }
\ No newline at end of file
+constexpr auto random_double(sampler& rng, double min, double max) -> double { return min + (max - min) * random_double(rng); }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
 
-#include "interval.hxx" // interval
-#include "ray.hxx"      // ray
-#include "record.hxx"   // hit_record
+#include "aabb.hxx"       // aabb
+#include "interval.hxx"   // interval
+#include "ray.hxx"        // ray
+#include "ray_packet.hxx" // ray_packet
+#include "record.hxx"     // hit_record
+#include "simd.hxx"       // for_each_lane
 
 class hittable
 {
@@ -11,4 +14,30 @@ public:
     virtual ~hittable() = default;
 
     virtual auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool = 0;
+
+    /**
+     * @brief Occlusion query: only tells whether something is hit, which lets implementations stop at the first hit.
+     */
+    virtual auto any_hit(ray const& r, interval ray_interval) const -> bool
+    {
+        hit_record rec;
+
+        return hit(r, ray_interval, rec);
+    }
+
+    /**
+     * @brief Traces the active rays of a packet, see ray_packet. By default the rays are traced one by one.
+     */
+    virtual auto hit_packet(ray_packet& packet) const -> void
+    {
+        for_each_lane(packet.active, [this, &packet](uint32_t const lane) {
+            if (hit(packet.rays[lane], packet.ranges[lane], packet.records[lane]))
+            {
+                packet.hits |= 1U << lane;
+                packet.ranges[lane].max = packet.records[lane].t;
+            }
+        });
+    }
+
+    virtual auto bounding_box() const -> aabb = 0;
 };
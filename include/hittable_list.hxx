@@ -2,8 +2,10 @@
 
 #include "hittable.hxx" // hittable, hit_record
 
-#include <memory> // std::make_shared
-#include <vector> // std::vector
+#include <algorithm> // std::ranges::any_of, std::ranges::for_each
+#include <memory>    // std::make_shared
+#include <span>      // std::span
+#include <vector>    // std::vector
 
 class hittable_list : public hittable
 {
@@ -13,9 +15,19 @@ public:
 
     explicit hittable_list(std::shared_ptr<hittable> object) { add(object); }
 
-    auto clear() -> void { m_objects.clear(); }
+    auto clear() -> void
+    {
+        m_objects.clear();
+        m_box = {};
+    }
+
+    auto add(std::shared_ptr<hittable> object) -> void
+    {
+        m_box = aabb(m_box, object->bounding_box());
+        m_objects.push_back(object);
+    }
 
-    auto add(std::shared_ptr<hittable> object) -> void { m_objects.push_back(object); }
+    auto objects() const -> std::span<std::shared_ptr<hittable> const> { return m_objects; }
 
     auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
     {
@@ -36,7 +48,21 @@ public:
         return hit_anything;
     }
 
+    auto any_hit(ray const& r, interval ray_interval) const -> bool override
+    {
+        return std::ranges::any_of(m_objects,
+                                   [&r, ray_interval](auto const& object) { return object->any_hit(r, ray_interval); });
+    }
+
+    auto hit_packet(ray_packet& packet) const -> void override
+    {
+        std::ranges::for_each(m_objects, [&packet](auto const& object) { object->hit_packet(packet); });
+    }
+
+    auto bounding_box() const -> aabb override { return m_box; }
+
 private:
 
     std::vector<std::shared_ptr<hittable>> m_objects;
+    aabb m_box;
 };
\ No newline at end of file
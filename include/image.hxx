@@ -0,0 +1,186 @@
+#pragma once
+
+#include "framebuffer.hxx" // framebuffer
+#include "mapped_file.hxx" // mapped_file
+
+#include <algorithm>  // std::ranges::copy, std::min
+#include <bit>        // std::endian
+#include <charconv>   // std::to_chars
+#include <cmath>      // std::sqrt
+#include <cstddef>    // std::byte, std::size_t
+#include <cstdint>    // uint8_t
+#include <cstring>    // std::memcpy
+#include <filesystem> // std::filesystem::path
+#include <format>     // std::format
+#include <ostream>    // std::ostream
+#include <ranges>     // std::views::iota
+#include <span>       // std::span
+#include <string>     // std::string
+#include <vector>     // std::vector
+
+enum class image_format
+{
+    ppm_ascii, // P3, one line of text per pixel.
+    ppm,       // P6, 8-bit gamma-corrected binary.
+    pfm        // PF, 32-bit linear floats.
+};
+
+/**
+ * @brief Picks the format matching the extension of a path: PFM for ".pfm", binary PPM otherwise.
+ */
+inline auto image_format_from(std::filesystem::path const& path) -> image_format
+{
+    return path.extension() == ".pfm" ? image_format::pfm : image_format::ppm;
+}
+
+/**
+ * @brief Gamma-corrects, clamps and quantizes linear components to [0,255], in a single branchless pass
+ * that compilers turn into vector code.
+ * @param linear The linear components.
+ * @param out    The quantized components, as many as the linear ones.
+ */
+inline auto encode_srgb8(std::span<float const> linear, std::span<uint8_t> out) -> void
+{
+    // Clamping before the square root is the same as clamping the gamma-corrected value to [0,0.999].
+    static constexpr auto max_linear = 0.999F * 0.999F;
+    auto const count = std::min(linear.size(), out.size());
+
+    auto const* const in = linear.data();
+    auto* const quantized = out.data();
+
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        auto const positive = in[k] > 0.0F ? in[k] : 0.0F;
+        auto const c = positive < max_linear ? positive : max_linear;
+        quantized[k] = static_cast<uint8_t>(256.0F * std::sqrt(c));
+    }
+}
+
+/**
+ * @brief Returns the header of an image file.
+ * @param image  The image to write.
+ * @param format The format of the file.
+ * @return The header, including the newline preceding the pixels.
+ */
+inline auto image_header(framebuffer const& image, image_format format) -> std::string
+{
+    switch (format)
+    {
+    case image_format::ppm_ascii:
+        return std::format("P3\n{} {}\n255\n", image.width(), image.height());
+    case image_format::ppm:
+        return std::format("P6\n{} {}\n255\n", image.width(), image.height());
+    case image_format::pfm:
+        // The sign of the scale gives the byte order of the floats.
+        return std::format("PF\n{} {}\n{}\n", image.width(), image.height(),
+                           std::endian::native == std::endian::little ? "-1.0" : "1.0");
+    }
+
+    return {};
+}
+
+/**
+ * @brief Encodes the pixels of an image in a binary format.
+ * @param image  The image to encode.
+ * @param format The binary format, either ppm or pfm.
+ * @param out    The destination, of binary_payload_size(image, format) bytes.
+ */
+inline auto encode_binary(framebuffer const& image, image_format format, std::span<std::byte> out) -> void
+{
+    if (format == image_format::pfm)
+    {
+        // PFM stores the rows from the bottom.
+        auto const row_bytes = static_cast<std::size_t>(image.width()) * 3 * sizeof(float);
+
+        for (auto const j : std::views::iota(0U, image.height()))
+        {
+            std::memcpy(out.subspan((image.height() - 1 - j) * row_bytes, row_bytes).data(), image.row(j).data(), row_bytes);
+        }
+
+        return;
+    }
+
+    encode_srgb8(image.data(), {reinterpret_cast<uint8_t*>(out.data()), out.size()});
+}
+
+inline auto binary_payload_size(framebuffer const& image, image_format format) -> std::size_t
+{
+    return image.data().size() * (format == image_format::pfm ? sizeof(float) : sizeof(uint8_t));
+}
+
+/**
+ * @brief Formats the pixels of an image as P3 text.
+ */
+inline auto encode_ascii(framebuffer const& image) -> std::string
+{
+    std::vector<uint8_t> components(image.data().size());
+    encode_srgb8(image.data(), components);
+
+    std::string text(components.size() * 4, '\0');
+    auto* cursor = text.data();
+
+    for (auto const k : std::views::iota(std::size_t{0}, components.size()))
+    {
+        cursor = std::to_chars(cursor, text.data() + text.size(), components[k]).ptr;
+        *cursor++ = (k % 3 == 2) ? '\n' : ' ';
+    }
+
+    text.resize(static_cast<std::size_t>(cursor - text.data()));
+
+    return text;
+}
+
+/**
+ * @brief Writes an image to a stream.
+ * @param image  The image to write.
+ * @param out    The output stream, opened in binary mode for binary formats.
+ * @param format The format to write.
+ */
+inline auto write_image(framebuffer const& image, std::ostream& out, image_format format) -> void
+{
+    out << image_header(image, format);
+
+    if (format == image_format::ppm_ascii)
+    {
+        out << encode_ascii(image);
+        return;
+    }
+
+    std::vector<std::byte> payload(binary_payload_size(image, format));
+    encode_binary(image, format, payload);
+    out.write(reinterpret_cast<char const*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+}
+
+/**
+ * @brief Writes an image to a file through a memory mapping, the pixels are encoded in place.
+ * @param image  The image to write.
+ * @param path   The file to create or overwrite.
+ * @param format The format to write.
+ */
+inline auto write_image(framebuffer const& image, std::filesystem::path const& path, image_format format) -> void
+{
+    auto const header = image_header(image, format);
+
+    if (format == image_format::ppm_ascii)
+    {
+        auto const text = encode_ascii(image);
+        auto file = mapped_file::create(path, header.size() + text.size());
+        auto const out = file.data();
+        std::memcpy(out.data(), header.data(), header.size());
+        std::memcpy(out.subspan(header.size()).data(), text.data(), text.size());
+
+        return;
+    }
+
+    auto file = mapped_file::create(path, header.size() + binary_payload_size(image, format));
+    std::memcpy(file.data().data(), header.data(), header.size());
+    encode_binary(image, format, file.data().subspan(header.size()));
+}
+
+/**
+ * @brief Writes an image to a file, in the format given by the extension of the path.
+ */
+inline auto write_image(framebuffer const& image, std::filesystem::path const& path) -> void
+{
+    write_image(image, path, image_format_from(path));
+}
@@ -12,6 +12,16 @@ public:
 
     constexpr interval(double min, double max) : min(min), max(max) {}
 
+    constexpr interval(interval const& a, interval const& b)
+        : min(a.min <= b.min ? a.min : b.min), max(a.max >= b.max ? a.max : b.max)
+    {}
+
+    constexpr auto size() const -> double { return max - min; }
+
+    constexpr auto center() const -> double { return 0.5 * (min + max); }
+
+    constexpr auto expand(double delta) const -> interval { return {min - delta / 2, max + delta / 2}; }
+
     constexpr auto contains(double value) const -> bool { return min <= value && value <= max; }
 
     constexpr auto surrounds(double value) const -> bool { return min < value && value < max; }
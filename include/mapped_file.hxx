@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cerrno>       // errno
+#include <cstddef>      // std::byte, std::size_t
+#include <filesystem>   // std::filesystem::path, std::filesystem::filesystem_error
+#include <span>         // std::span
+#include <system_error> // std::error_code, std::system_category
+#include <utility>      // std::exchange
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h> // CreateFileW, CreateFileMappingW, MapViewOfFile
+#else
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h>   // close, ftruncate
+#endif
+
+/**
+ * @brief Memory mapping of a whole file, either read-only or created with a fixed size for writing.
+ */
+class mapped_file
+{
+public:
+
+    mapped_file() = default;
+
+    mapped_file(mapped_file const&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0))
+    {}
+
+    auto operator=(mapped_file const&) -> mapped_file& = delete;
+
+    auto operator=(mapped_file&& other) noexcept -> mapped_file&
+    {
+        if (this != &other)
+        {
+            unmap();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+        }
+
+        return *this;
+    }
+
+    ~mapped_file() { unmap(); }
+
+    /**
+     * @brief Maps an existing file for reading.
+     * @param path The file to map.
+     * @return The mapping, empty if the file is empty.
+     */
+    static auto open(std::filesystem::path const& path) -> mapped_file
+    {
+        if (!std::filesystem::exists(path))
+        {
+            throw std::filesystem::filesystem_error("file not found", path,
+                                                    std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+
+        return map(path, std::filesystem::file_size(path), false);
+    }
+
+    /**
+     * @brief Creates, or truncates, a file of the given size and maps it for writing.
+     * @param path The file to create.
+     * @param size The size of the file in bytes.
+     * @return The mapping.
+     */
+    static auto create(std::filesystem::path const& path, std::size_t size) -> mapped_file { return map(path, size, true); }
+
+    auto data() const -> std::span<std::byte const> { return {m_data, m_size}; }
+
+    auto data() -> std::span<std::byte> { return {m_data, m_size}; }
+
+    auto size() const -> std::size_t { return m_size; }
+
+private:
+
+#ifdef _WIN32
+    static auto map(std::filesystem::path const& path, std::size_t size, bool writable) -> mapped_file
+    {
+        auto const fail = [&path](char const* what) {
+            throw std::filesystem::filesystem_error(what, path,
+                                                    std::error_code(static_cast<int>(GetLastError()), std::system_category()));
+        };
+
+        auto const file = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                                      FILE_SHARE_READ, nullptr, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE) [[unlikely]] { fail("file not opened"); }
+
+        mapped_file mapped;
+        mapped.m_size = size;
+
+        if (size > 0)
+        {
+            auto const mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                                    static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32U),
+                                                    static_cast<DWORD>(size & 0xFFFFFFFFU), nullptr);
+
+            if (mapping == nullptr) [[unlikely]]
+            {
+                CloseHandle(file);
+                fail("file not mapped");
+            }
+
+            auto* const view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+            CloseHandle(mapping);
+
+            if (view == nullptr) [[unlikely]]
+            {
+                CloseHandle(file);
+                fail("file not mapped");
+            }
+
+            mapped.m_data = static_cast<std::byte*>(view);
+        }
+
+        CloseHandle(file);
+
+        return mapped;
+    }
+
+    auto unmap() -> void
+    {
+        if (m_data != nullptr) { UnmapViewOfFile(m_data); }
+        m_data = nullptr;
+        m_size = 0;
+    }
+#else
+    static auto map(std::filesystem::path const& path, std::size_t size, bool writable) -> mapped_file
+    {
+        auto const fail = [&path](char const* what) {
+            throw std::filesystem::filesystem_error(what, path, std::error_code(errno, std::system_category()));
+        };
+
+        auto const fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : ::open(path.c_str(), O_RDONLY);
+
+        if (fd < 0) [[unlikely]] { fail("file not opened"); }
+
+        if (writable && ::ftruncate(fd, static_cast<off_t>(size)) != 0) [[unlikely]]
+        {
+            ::close(fd);
+            fail("file not resized");
+        }
+
+        mapped_file mapped;
+        mapped.m_size = size;
+
+        if (size > 0)
+        {
+            auto const protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            auto* const view = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+
+            if (view == MAP_FAILED) [[unlikely]]
+            {
+                ::close(fd);
+                fail("file not mapped");
+            }
+
+            mapped.m_data = static_cast<std::byte*>(view);
+        }
+
+        ::close(fd);
+
+        return mapped;
+    }
+
+    auto unmap() -> void
+    {
+        if (m_data != nullptr) { ::munmap(m_data, m_size); }
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+
+    std::byte* m_data{nullptr};
+    std::size_t m_size{0};
+};
@@ -4,6 +4,11 @@
 #include "hittable.hxx" // hit_record
 #include "ray.hxx"      // ray
 
+#include <cstddef> // std::size_t
+#include <memory>  // std::unique_ptr, std::make_unique
+#include <utility> // std::forward
+#include <vector>  // std::vector
+
 class material
 {
 public:
@@ -12,7 +17,8 @@ public:
 
     virtual auto get_color() const -> color = 0;
 
-    virtual auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered) const -> bool = 0;
+    virtual auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered, sampler& rng) const
+        -> bool = 0;
 };
 
 class lambertian : public material
@@ -23,9 +29,10 @@ public:
 
     auto get_color() const -> color override { return m_albedo; }
 
-    auto scatter(ray const& /* r_in */, hit_record const& rec, color& attenuation, ray& scattered) const -> bool override
+    auto scatter(ray const& /* r_in */, hit_record const& rec, color& attenuation, ray& scattered, sampler& rng) const
+        -> bool override
     {
-        auto scatter_direction = rec.normal + random_unit_vector();
+        auto scatter_direction = rec.normal + random_unit_vector(rng);
 
         if (scatter_direction.near_zero()) { scatter_direction = rec.normal; }
 
@@ -48,10 +55,11 @@ public:
 
     auto get_color() const -> color override { return m_albedo; }
 
-    auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered) const -> bool override
+    auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered, sampler& rng) const
+        -> bool override
     {
         auto const reflected = reflect(unit_vector(r_in.direction()), rec.normal);
-        scattered = ray(rec.p, reflected + m_fuzz * random_in_unit_sphere());
+        scattered = ray(rec.p, reflected + m_fuzz * random_in_unit_sphere(rng));
         attenuation = m_albedo;
 
         return (dot(scattered.direction(), rec.normal) > 0.0);
@@ -71,7 +79,8 @@ public:
 
     auto get_color() const -> color override { return {1.0, 1.0, 1.0}; }
 
-    auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered) const -> bool override
+    auto scatter(ray const& r_in, hit_record const& rec, color& attenuation, ray& scattered, sampler& rng) const
+        -> bool override
     {
         attenuation = {1.0, 1.0, 1.0};
         auto const refraction_ratio = rec.front_face ? (1.0 / m_ir) : m_ir;
@@ -79,7 +88,7 @@ public:
         auto const cos_theta = fmin(dot(-unit_direction, rec.normal), 1.0);
         auto const sin_theta = sqrt(1.0 - cos_theta * cos_theta);
         auto const cannot_refract = refraction_ratio * sin_theta > 1.0;
-        auto const direction = cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double()
+        auto const direction = cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double(rng)
                                    ? reflect(unit_direction, rec.normal)
                                    : refract(unit_direction, rec.normal, refraction_ratio);
 
@@ -98,4 +107,29 @@ private:
     }
 
     double m_ir;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Owns the materials of a scene. Primitives and hit records only keep the index of theirs, and the
+ * material is looked up once per shaded hit, so intersecting never touches a reference count.
+ */
+class material_table
+{
+public:
+
+    template <typename T, typename... Args>
+    auto emplace(Args&&... args) -> material_id
+    {
+        m_materials.push_back(std::make_unique<T>(std::forward<Args>(args)...));
+
+        return static_cast<material_id>(m_materials.size() - 1);
+    }
+
+    auto operator[](material_id const id) const -> material const& { return *m_materials[id]; }
+
+    auto size() const -> std::size_t { return m_materials.size(); }
+
+private:
+
+    std::vector<std::unique_ptr<material>> m_materials;
+};
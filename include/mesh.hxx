@@ -0,0 +1,160 @@
+#pragma once
+
+#include "bvh.hxx"      // bvh_tree
+#include "hittable.hxx" // hittable
+#include "simd.hxx"     // for_each_lane
+#include "triangle.hxx" // triangle4
+#include "vec3.hxx"     // vec3
+
+#include <algorithm> // std::ranges::transform
+#include <array>     // std::array
+#include <cstddef>   // std::size_t
+#include <cstdint>   // uint32_t
+#include <memory>    // std::shared_ptr
+#include <ranges>    // std::views::iota
+#include <vector>    // std::vector
+
+/**
+ * @brief Triangle mesh stored once: a vertex buffer and three vertex indices per face.
+ */
+struct indexed_mesh
+{
+    std::vector<point3> vertices;
+    std::vector<std::array<uint32_t, 3>> faces;
+};
+
+/**
+ * @brief A whole indexed mesh as a single hittable, with its own hierarchy over the faces.
+ * The mesh buffers are shared, so the same mesh can be placed in a scene several times at no cost.
+ */
+class mesh : public hittable
+{
+public:
+
+    mesh(std::shared_ptr<indexed_mesh const> data, material_id mat_id) : m_data(std::move(data)), m_mat_id(mat_id)
+    {
+        std::vector<aabb> boxes(m_data->faces.size());
+        std::ranges::transform(m_data->faces, boxes.begin(), [this](auto const& face) {
+            auto const [v0, v1, v2] = vertices_of(face);
+
+            return aabb(aabb(v0, v1), aabb(v2, v2)).pad();
+        });
+        m_tree = bvh_tree(boxes, triangle4::width);
+        m_tree.align_leaves(triangle4::width);
+        fill_blocks();
+    }
+
+    /**
+     * @brief Wraps a mesh with the hierarchy built for it before, taken from tree(), without building anything.
+     */
+    mesh(std::shared_ptr<indexed_mesh const> data, material_id mat_id, bvh_tree tree)
+        : m_data(std::move(data)), m_mat_id(mat_id), m_tree(std::move(tree))
+    {
+        fill_blocks();
+    }
+
+    auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
+    {
+        uint32_t hit_face{0};
+        auto hit_t = 0.0;
+        auto const found = m_tree.closest_hit(r, ray_interval, [&](uint32_t first, uint32_t /* count */, interval& range) {
+            auto const& block = m_blocks[first / triangle4::width];
+            auto const lane = block.intersect(r, range, hit_t);
+
+            if (lane == triangle4::width) { return false; }
+
+            hit_face = block.index[lane];
+            range.max = hit_t;
+
+            return true;
+        });
+
+        if (!found) { return false; }
+
+        // Only the closest face needs a hit record.
+        fill_record(r, hit_face, hit_t, rec);
+
+        return true;
+    }
+
+    auto hit_packet(ray_packet& packet) const -> void override
+    {
+        std::array<uint32_t, ray_packet::width> hit_face{};
+        uint32_t hits{0};
+
+        m_tree.closest_hit(packet, [&](uint32_t first, uint32_t /* count */) {
+            auto const& block = m_blocks[first / triangle4::width];
+
+            for_each_lane(packet.active, [&](uint32_t const lane) {
+                auto t = 0.0;
+                auto const k = block.intersect(packet.rays[lane], packet.ranges[lane], t);
+
+                if (k == triangle4::width) { return; }
+
+                hit_face[lane] = block.index[k];
+                hits |= 1U << lane;
+                packet.ranges[lane].max = t;
+            });
+        });
+
+        for_each_lane(hits, [&](uint32_t const lane) {
+            fill_record(packet.rays[lane], hit_face[lane], packet.ranges[lane].max, packet.records[lane]);
+        });
+        packet.hits |= hits;
+    }
+
+    auto any_hit(ray const& r, interval ray_interval) const -> bool override
+    {
+        return m_tree.any_hit(r, ray_interval, [this, &r](uint32_t first, uint32_t /* count */, interval const& range) {
+            auto t = 0.0;
+
+            return m_blocks[first / triangle4::width].intersect(r, range, t) != triangle4::width;
+        });
+    }
+
+    auto bounding_box() const -> aabb override { return m_tree.bounding_box(); }
+
+    auto data() const -> indexed_mesh const& { return *m_data; }
+
+    auto mat_id() const -> material_id { return m_mat_id; }
+
+    auto tree() const -> bvh_tree const& { return m_tree; }
+
+private:
+
+    /**
+     * @brief Copies the faces of each leaf into one block, found at the first index of the leaf divided by the block width.
+     */
+    auto fill_blocks() -> void
+    {
+        auto const indices = m_tree.indices();
+        m_blocks.resize(indices.size() / triangle4::width);
+
+        for (auto const k : std::views::iota(std::size_t{0}, indices.size()))
+        {
+            if (indices[k] == bvh_tree::invalid_index) { continue; }
+
+            auto const [v0, v1, v2] = vertices_of(m_data->faces[indices[k]]);
+            m_blocks[k / triangle4::width].set(k % triangle4::width, v0, v1, v2, indices[k]);
+        }
+    }
+
+    auto vertices_of(std::array<uint32_t, 3> const& face) const -> std::array<point3, 3>
+    {
+        return {m_data->vertices[face[0]], m_data->vertices[face[1]], m_data->vertices[face[2]]};
+    }
+
+    auto fill_record(ray const& r, uint32_t face, double t, hit_record& rec) const -> void
+    {
+        auto const [v0, v1, v2] = vertices_of(m_data->faces[face]);
+        rec.t = t;
+        rec.p = r.at(rec.t);
+        rec.set_face_normal(r, unit_vector(cross(v1 - v0, v2 - v0)));
+        rec.mat_id = m_mat_id;
+    }
+
+    std::shared_ptr<indexed_mesh const> m_data;
+    material_id m_mat_id;
+    bvh_tree m_tree;
+    std::vector<triangle4> m_blocks;
+};
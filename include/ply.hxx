@@ -0,0 +1,648 @@
+#pragma once
+
+#include "mapped_file.hxx" // mapped_file
+#include "mesh.hxx"        // indexed_mesh
+
+#include <algorithm>   // std::ranges::find_if, std::ranges::count, std::ranges::any_of, std::find, std::reverse
+#include <array>       // std::array
+#include <bit>         // std::endian
+#include <charconv>    // std::from_chars
+#include <cmath>       // std::floor
+#include <cstddef>     // std::byte, std::size_t
+#include <cstdint>     // int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t
+#include <cstring>     // std::memcpy
+#include <exception>   // std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <filesystem>  // std::filesystem::path
+#include <numeric>     // std::exclusive_scan, std::reduce
+#include <mutex>       // std::mutex, std::scoped_lock
+#include <optional>    // std::optional
+#include <ranges>      // std::views::iota
+#include <span>        // std::span
+#include <stdexcept>   // std::runtime_error
+#include <string>      // std::string
+#include <string_view> // std::string_view
+#include <thread>      // std::jthread
+#include <utility>     // std::pair
+#include <vector>      // std::vector
+
+enum class ply_format
+{
+    ascii,
+    binary_little_endian,
+    binary_big_endian
+};
+
+enum class ply_type
+{
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    float32,
+    float64
+};
+
+struct ply_property
+{
+    std::string name;
+    ply_type type{ply_type::float32};
+    std::optional<ply_type> count_type; // Set for list properties, the type of the item count preceding the items.
+};
+
+struct ply_element
+{
+    std::string name;
+    std::size_t count{0};
+    std::vector<ply_property> properties;
+};
+
+struct ply_header
+{
+    ply_format format{ply_format::ascii};
+    std::vector<ply_element> elements;
+    std::size_t body_offset{0}; // Offset of the first byte after the end_header line.
+};
+
+/**
+ * @brief Parses a PLY scalar type name, either the original (uchar) or the sized (uint8) spelling.
+ */
+inline auto ply_type_from(std::string_view name) -> ply_type
+{
+    static constexpr std::array<std::pair<std::string_view, ply_type>, 16> names{{
+        {"char", ply_type::int8},
+        {"int8", ply_type::int8},
+        {"uchar", ply_type::uint8},
+        {"uint8", ply_type::uint8},
+        {"short", ply_type::int16},
+        {"int16", ply_type::int16},
+        {"ushort", ply_type::uint16},
+        {"uint16", ply_type::uint16},
+        {"int", ply_type::int32},
+        {"int32", ply_type::int32},
+        {"uint", ply_type::uint32},
+        {"uint32", ply_type::uint32},
+        {"float", ply_type::float32},
+        {"float32", ply_type::float32},
+        {"double", ply_type::float64},
+        {"float64", ply_type::float64},
+    }};
+
+    auto const it = std::ranges::find_if(names, [name](auto const& entry) { return entry.first == name; });
+
+    if (it == names.end()) [[unlikely]] { throw std::runtime_error("invalid ply property type"); }
+
+    return it->second;
+}
+
+constexpr auto ply_type_size(ply_type type) -> std::size_t
+{
+    switch (type)
+    {
+    case ply_type::int8:
+    case ply_type::uint8:
+        return 1;
+    case ply_type::int16:
+    case ply_type::uint16:
+        return 2;
+    case ply_type::int32:
+    case ply_type::uint32:
+    case ply_type::float32:
+        return 4;
+    case ply_type::float64:
+        return 8;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Splits a line of text on spaces and tabs.
+ */
+inline auto ply_split_words(std::string_view line) -> std::vector<std::string_view>
+{
+    std::vector<std::string_view> words;
+
+    while (!line.empty())
+    {
+        auto const start = line.find_first_not_of(" \t\r");
+
+        if (start == std::string_view::npos) { break; }
+
+        line.remove_prefix(start);
+        auto const length = std::min(line.find_first_of(" \t\r"), line.size());
+        words.push_back(line.substr(0, length));
+        line.remove_prefix(length);
+    }
+
+    return words;
+}
+
+/**
+ * @brief Parses the header of a PLY file.
+ * @param text The whole file, only the header is read.
+ * @return The format, the elements with their properties, and where the body starts.
+ */
+inline auto parse_ply_header(std::string_view text) -> ply_header
+{
+    ply_header header;
+    std::size_t position{0};
+    bool magic = false;
+
+    while (position < text.size())
+    {
+        auto const line_end = std::min(text.find('\n', position), text.size());
+        auto const words = ply_split_words(text.substr(position, line_end - position));
+        position = line_end + 1;
+
+        if (!magic)
+        {
+            if (words.size() != 1 || words[0] != "ply") [[unlikely]] { throw std::runtime_error("not a ply file"); }
+            magic = true;
+        }
+        else if (words.empty() || words[0] == "comment" || words[0] == "obj_info") { continue; }
+        else if (words[0] == "end_header")
+        {
+            header.body_offset = std::min(position, text.size());
+
+            return header;
+        }
+        else if (words[0] == "format" && words.size() >= 2)
+        {
+            if (words[1] == "ascii") { header.format = ply_format::ascii; }
+            else if (words[1] == "binary_little_endian") { header.format = ply_format::binary_little_endian; }
+            else if (words[1] == "binary_big_endian") { header.format = ply_format::binary_big_endian; }
+            else [[unlikely]] { throw std::runtime_error("invalid ply format"); }
+        }
+        else if (words[0] == "element" && words.size() == 3)
+        {
+            ply_element element{std::string(words[1]), 0, {}};
+            auto const [ptr, ec] = std::from_chars(words[2].data(), words[2].data() + words[2].size(), element.count);
+
+            if (ec != std::errc()) [[unlikely]] { throw std::runtime_error("invalid element count"); }
+
+            header.elements.push_back(std::move(element));
+        }
+        else if (words[0] == "property" && !header.elements.empty())
+        {
+            auto& properties = header.elements.back().properties;
+
+            if (words.size() == 5 && words[1] == "list")
+            {
+                properties.push_back({std::string(words[4]), ply_type_from(words[3]), ply_type_from(words[2])});
+            }
+            else if (words.size() == 3) { properties.push_back({std::string(words[2]), ply_type_from(words[1]), {}}); }
+            else [[unlikely]] { throw std::runtime_error("invalid ply property"); }
+        }
+        else [[unlikely]] { throw std::runtime_error("invalid ply header line"); }
+    }
+
+    throw std::runtime_error("missing end_header");
+}
+
+/**
+ * @brief Where the mesh data lives among the elements and properties of a PLY file.
+ */
+struct ply_mesh_layout
+{
+    std::size_t vertex_element{0};
+    std::size_t face_element{0};
+    std::array<std::size_t, 3> position{}; // Property indices of x, y and z.
+    std::size_t indices{0};                // Property index of the vertex index list.
+
+    explicit ply_mesh_layout(ply_header const& header)
+    {
+        auto const find_element = [&header](std::string_view name) {
+            auto const it = std::ranges::find_if(header.elements, [name](auto const& e) { return e.name == name; });
+
+            if (it == header.elements.end()) [[unlikely]] { throw std::runtime_error("missing ply element"); }
+
+            return static_cast<std::size_t>(it - header.elements.begin());
+        };
+
+        vertex_element = find_element("vertex");
+        face_element = find_element("face");
+
+        auto const& vertex_properties = header.elements[vertex_element].properties;
+
+        for (auto const axis : {0UL, 1UL, 2UL})
+        {
+            auto const name = std::string_view("xyz").substr(axis, 1);
+            auto const it = std::ranges::find_if(vertex_properties, [name](auto const& p) { return p.name == name; });
+
+            if (it == vertex_properties.end() || it->count_type) [[unlikely]]
+            {
+                throw std::runtime_error("missing vertex position");
+            }
+
+            position[axis] = static_cast<std::size_t>(it - vertex_properties.begin());
+        }
+
+        auto const& face_properties = header.elements[face_element].properties;
+        auto const it = std::ranges::find_if(face_properties, [](auto const& p) {
+            return p.count_type && (p.name == "vertex_indices" || p.name == "vertex_index");
+        });
+
+        if (it == face_properties.end()) [[unlikely]] { throw std::runtime_error("missing face vertex indices"); }
+
+        indices = static_cast<std::size_t>(it - face_properties.begin());
+    }
+};
+
+/**
+ * @brief Converts a vertex index read as a number, checking it before the cast since a negative, fractional or huge
+ * value does not convert.
+ */
+inline auto ply_vertex_index(double const value, std::size_t const vertex_count) -> uint32_t
+{
+    if (!(value >= 0.0 && value < static_cast<double>(vertex_count) && value == std::floor(value))) [[unlikely]]
+    {
+        throw std::runtime_error("invalid vertex index");
+    }
+
+    return static_cast<uint32_t>(value);
+}
+
+/**
+ * @brief Converts the item count of a list read as a number, checked the same way as a vertex index.
+ * @param max_count The most items the rest of the body can hold, so that a huge count fails here instead of
+ *                  running the item loop past the data.
+ */
+inline auto ply_list_count(double const value, std::size_t const max_count) -> std::size_t
+{
+    if (!(value >= 0.0 && value <= static_cast<double>(max_count) && value == std::floor(value))) [[unlikely]]
+    {
+        throw std::runtime_error("invalid ply list count");
+    }
+
+    return static_cast<std::size_t>(value);
+}
+
+/**
+ * @brief Appends the triangles of a polygon, fanned around its first vertex.
+ */
+inline auto ply_add_polygon(std::span<uint32_t const> polygon, std::size_t vertex_count,
+                            std::vector<std::array<uint32_t, 3>>& faces) -> void
+{
+    if (std::ranges::any_of(polygon, [vertex_count](uint32_t const idx) { return idx >= vertex_count; })) [[unlikely]]
+    {
+        throw std::runtime_error("invalid vertex index");
+    }
+
+    for (std::size_t k = 2; k < polygon.size(); ++k) { faces.push_back({polygon[0], polygon[k - 1], polygon[k]}); }
+}
+
+/**
+ * @brief Runs fn(index) for each index in [0,count) on all the hardware threads.
+ * The first exception thrown by fn is rethrown once every thread is done.
+ */
+template <typename F>
+auto ply_parallel_for(std::size_t count, F&& fn) -> void
+{
+    auto const thread_count = std::min<std::size_t>(std::max(std::jthread::hardware_concurrency(), 1U), count);
+
+    if (thread_count <= 1)
+    {
+        for (auto const idx : std::views::iota(std::size_t{0}, count)) { fn(idx); }
+        return;
+    }
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(thread_count);
+
+        for (auto const t : std::views::iota(std::size_t{0}, thread_count))
+        {
+            threads.emplace_back([&fn, &error, &error_mutex, t, thread_count, count] {
+                try
+                {
+                    for (auto idx = t; idx < count; idx += thread_count) { fn(idx); }
+                }
+                catch (...)
+                {
+                    std::scoped_lock const lock(error_mutex);
+                    if (!error) { error = std::current_exception(); }
+                }
+            });
+        }
+    }
+
+    if (error) [[unlikely]] { std::rethrow_exception(error); }
+}
+
+/**
+ * @brief Parses the body of an ASCII PLY file.
+ * The body is cut in chunks on line boundaries. The lines of each chunk are counted in parallel, which gives
+ * the element every line belongs to, then the chunks are parsed in parallel.
+ */
+inline auto parse_ply_ascii(std::string_view body, ply_header const& header, indexed_mesh& mesh) -> void
+{
+    static constexpr std::size_t min_chunk_size{1UL << 20U};
+    ply_mesh_layout const layout(header);
+    auto const max_chunks = 4 * static_cast<std::size_t>(std::max(std::jthread::hardware_concurrency(), 1U));
+    auto const chunk_count = std::clamp<std::size_t>(body.size() / min_chunk_size, 1, max_chunks);
+
+    std::vector<std::size_t> bounds(chunk_count + 1, body.size());
+    bounds[0] = 0;
+
+    for (auto const c : std::views::iota(std::size_t{1}, chunk_count))
+    {
+        auto const newline = body.find('\n', std::max(bounds[c - 1], c * body.size() / chunk_count));
+        bounds[c] = newline == std::string_view::npos ? body.size() : newline + 1;
+    }
+
+    std::vector<std::size_t> first_line(chunk_count);
+    ply_parallel_for(chunk_count, [&](std::size_t const c) {
+        auto const chunk = body.substr(bounds[c], bounds[c + 1] - bounds[c]);
+        first_line[c] = static_cast<std::size_t>(std::ranges::count(chunk, '\n'));
+
+        if (!chunk.empty() && chunk.back() != '\n') { ++first_line[c]; }
+    });
+    auto const line_count = std::reduce(first_line.begin(), first_line.end(), std::size_t{0});
+    std::exclusive_scan(first_line.begin(), first_line.end(), first_line.begin(), std::size_t{0});
+
+    std::vector<std::size_t> element_first_line(header.elements.size() + 1, 0);
+
+    for (auto const e : std::views::iota(std::size_t{0}, header.elements.size()))
+    {
+        element_first_line[e + 1] = element_first_line[e] + header.elements[e].count;
+    }
+
+    if (line_count < element_first_line.back()) [[unlikely]] { throw std::runtime_error("truncated ply body"); }
+
+    auto const vertex_count = header.elements[layout.vertex_element].count;
+    mesh.vertices.resize(vertex_count);
+    std::vector<std::vector<std::array<uint32_t, 3>>> chunk_faces(chunk_count);
+
+    ply_parallel_for(chunk_count, [&](std::size_t const c) {
+        auto const* cursor = body.data() + bounds[c];
+        auto const* const end = body.data() + bounds[c + 1];
+        auto const read_number = [&cursor, end]() -> double {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) { ++cursor; }
+
+            double value{0.0};
+            auto const [ptr, ec] = std::from_chars(cursor, end, value);
+
+            if (ec != std::errc()) [[unlikely]] { throw std::runtime_error("invalid ply value"); }
+
+            cursor = ptr;
+
+            return value;
+        };
+
+        std::vector<uint32_t> polygon;
+        std::size_t element{0};
+
+        for (auto line = first_line[c]; cursor < end; ++line)
+        {
+            while (element < header.elements.size() && line >= element_first_line[element + 1]) { ++element; }
+
+            if (element >= header.elements.size()) { break; }
+
+            auto const* const line_end = std::find(cursor, end, '\n');
+            auto const& properties = header.elements[element].properties;
+            auto const read_count = [&] {
+                auto const value = read_number();
+
+                // Each item takes at least one character and one separator.
+                return ply_list_count(value, static_cast<std::size_t>(line_end - cursor + 1) / 2);
+            };
+
+            if (element == layout.vertex_element)
+            {
+                auto& vertex = mesh.vertices[line - element_first_line[element]];
+
+                for (auto const p : std::views::iota(std::size_t{0}, properties.size()))
+                {
+                    auto const item_count = properties[p].count_type ? read_count() : 1;
+
+                    for (std::size_t item = 0; item < item_count; ++item)
+                    {
+                        auto const value = read_number();
+
+                        for (auto const axis : {0, 1, 2})
+                        {
+                            if (p == layout.position[static_cast<std::size_t>(axis)]) { vertex[axis] = value; }
+                        }
+                    }
+                }
+            }
+            else if (element == layout.face_element)
+            {
+                for (auto const p : std::views::iota(std::size_t{0}, properties.size()))
+                {
+                    auto const item_count = properties[p].count_type ? read_count() : 1;
+                    polygon.clear();
+
+                    for (std::size_t item = 0; item < item_count; ++item)
+                    {
+                        auto const value = read_number();
+
+                        if (p == layout.indices) { polygon.push_back(ply_vertex_index(value, vertex_count)); }
+                    }
+
+                    if (p == layout.indices) { ply_add_polygon(polygon, vertex_count, chunk_faces[c]); }
+                }
+            }
+
+            cursor = line_end == end ? end : line_end + 1;
+        }
+    });
+
+    for (auto& faces : chunk_faces) { mesh.faces.insert(mesh.faces.end(), faces.begin(), faces.end()); }
+}
+
+/**
+ * @brief Reads one binary scalar and converts it to double.
+ * @param cursor The position of the value, moved past it.
+ * @param end    The end of the body.
+ * @param type   The type of the value.
+ * @param swap   Whether the file byte order differs from the native one.
+ */
+inline auto ply_read_binary(std::byte const*& cursor, std::byte const* end, ply_type type, bool swap) -> double
+{
+    auto const size = ply_type_size(type);
+
+    if (static_cast<std::size_t>(end - cursor) < size) [[unlikely]] { throw std::runtime_error("truncated ply body"); }
+
+    std::array<std::byte, 8> bytes{};
+    std::memcpy(bytes.data(), cursor, size);
+    cursor += size;
+
+    if (swap) { std::reverse(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size)); }
+
+    auto const as = [&bytes]<typename T>(T) -> double {
+        T value{};
+        std::memcpy(&value, bytes.data(), sizeof(T));
+
+        return static_cast<double>(value);
+    };
+
+    switch (type)
+    {
+    case ply_type::int8:
+        return as(int8_t{});
+    case ply_type::uint8:
+        return as(uint8_t{});
+    case ply_type::int16:
+        return as(int16_t{});
+    case ply_type::uint16:
+        return as(uint16_t{});
+    case ply_type::int32:
+        return as(int32_t{});
+    case ply_type::uint32:
+        return as(uint32_t{});
+    case ply_type::float32:
+        return as(float{});
+    case ply_type::float64:
+        return as(double{});
+    }
+
+    return 0.0;
+}
+
+/**
+ * @brief Parses the body of a binary PLY file.
+ * Vertices without list properties have a fixed stride and are decoded in parallel, faces are walked in order.
+ */
+inline auto parse_ply_binary(std::span<std::byte const> body, ply_header const& header, indexed_mesh& mesh) -> void
+{
+    ply_mesh_layout const layout(header);
+    auto const swap = (header.format == ply_format::binary_little_endian) != (std::endian::native == std::endian::little);
+    auto const* cursor = body.data();
+    auto const* const end = body.data() + body.size();
+    auto const vertex_count = header.elements[layout.vertex_element].count;
+    std::vector<uint32_t> polygon;
+
+    auto const read_count = [&cursor, end, swap](ply_property const& property) {
+        auto const value = ply_read_binary(cursor, end, *property.count_type, swap);
+
+        return ply_list_count(value, static_cast<std::size_t>(end - cursor) / ply_type_size(property.type));
+    };
+    auto const skip_entry = [&cursor, end, &read_count](ply_element const& element) {
+        for (auto const& property : element.properties)
+        {
+            auto const item_count = property.count_type ? read_count(property) : 1;
+            auto const size = item_count * ply_type_size(property.type);
+
+            if (static_cast<std::size_t>(end - cursor) < size) [[unlikely]] { throw std::runtime_error("truncated ply body"); }
+
+            cursor += size;
+        }
+    };
+
+    for (auto const e : std::views::iota(std::size_t{0}, header.elements.size()))
+    {
+        auto const& element = header.elements[e];
+        auto const& properties = element.properties;
+
+        auto const fixed_size = std::ranges::none_of(properties, [](auto const& p) { return p.count_type.has_value(); });
+
+        if (e == layout.vertex_element && fixed_size)
+        {
+            std::vector<std::size_t> offsets(properties.size(), 0);
+            std::size_t stride{0};
+
+            for (auto const p : std::views::iota(std::size_t{0}, properties.size()))
+            {
+                offsets[p] = stride;
+                stride += ply_type_size(properties[p].type);
+            }
+
+            if (static_cast<std::size_t>(end - cursor) < stride * element.count) [[unlikely]]
+            {
+                throw std::runtime_error("truncated ply body");
+            }
+
+            static constexpr std::size_t block_size{1UL << 16U};
+            auto const* const first = cursor;
+            mesh.vertices.resize(element.count);
+            ply_parallel_for((element.count + block_size - 1) / block_size, [&](std::size_t const block) {
+                auto const last = std::min(element.count, (block + 1) * block_size);
+
+                for (auto v = block * block_size; v < last; ++v)
+                {
+                    for (auto const axis : {0, 1, 2})
+                    {
+                        auto const p = layout.position[static_cast<std::size_t>(axis)];
+                        auto const* value = first + v * stride + offsets[p];
+                        mesh.vertices[v][axis] = ply_read_binary(value, end, properties[p].type, swap);
+                    }
+                }
+            });
+            cursor += stride * element.count;
+        }
+        else if (e == layout.vertex_element)
+        {
+            mesh.vertices.resize(element.count);
+
+            for (auto& vertex : mesh.vertices)
+            {
+                for (auto const p : std::views::iota(std::size_t{0}, properties.size()))
+                {
+                    auto const item_count = properties[p].count_type ? read_count(properties[p]) : 1;
+
+                    for (std::size_t item = 0; item < item_count; ++item)
+                    {
+                        auto const value = ply_read_binary(cursor, end, properties[p].type, swap);
+
+                        for (auto const axis : {0, 1, 2})
+                        {
+                            if (p == layout.position[static_cast<std::size_t>(axis)]) { vertex[axis] = value; }
+                        }
+                    }
+                }
+            }
+        }
+        else if (e == layout.face_element)
+        {
+            mesh.faces.reserve(element.count);
+
+            for (std::size_t f = 0; f < element.count; ++f)
+            {
+                for (auto const p : std::views::iota(std::size_t{0}, properties.size()))
+                {
+                    auto const item_count = properties[p].count_type ? read_count(properties[p]) : 1;
+                    polygon.clear();
+
+                    for (std::size_t item = 0; item < item_count; ++item)
+                    {
+                        auto const value = ply_read_binary(cursor, end, properties[p].type, swap);
+
+                        if (p == layout.indices) { polygon.push_back(ply_vertex_index(value, vertex_count)); }
+                    }
+
+                    if (p == layout.indices) { ply_add_polygon(polygon, vertex_count, mesh.faces); }
+                }
+            }
+        }
+        else
+        {
+            for (std::size_t entry = 0; entry < element.count; ++entry) { skip_entry(element); }
+        }
+    }
+}
+
+/**
+ * @brief Loads the vertices and faces of a PLY file, in ASCII or binary format, through a memory mapping.
+ * Polygons are split in triangles.
+ * @param path The file to load.
+ * @return The indexed mesh.
+ */
+inline auto load_ply(std::filesystem::path const& path) -> indexed_mesh
+{
+    auto const file = mapped_file::open(path);
+    auto const bytes = file.data();
+    std::string_view const text(reinterpret_cast<char const*>(bytes.data()), bytes.size());
+    auto const header = parse_ply_header(text);
+    indexed_mesh mesh;
+
+    if (header.format == ply_format::ascii) { parse_ply_ascii(text.substr(header.body_offset), header, mesh); }
+    else { parse_ply_binary(bytes.subspan(header.body_offset), header, mesh); }
+
+    return mesh;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "interval.hxx" // interval
+#include "ray.hxx"      // ray
+#include "record.hxx"   // hit_record
+#include "simd.hxx"     // vec3x4, double4
+
+#include <array>   // std::array
+#include <cstdint> // uint32_t
+
+/**
+ * @brief A few coherent rays traced together, each with its own search range and hit record.
+ * Hittables only trace the lanes set in active, and on a hit they set the lane in hits, fill its record and
+ * shrink its range to the distance of the hit, exactly like the single ray closest_so_far loop.
+ */
+struct ray_packet
+{
+    static constexpr uint32_t width{double4::width};
+    static constexpr uint32_t all_lanes{(1U << width) - 1};
+
+    std::array<ray, width> rays;
+    std::array<interval, width> ranges;
+    std::array<hit_record, width> records;
+    uint32_t active{all_lanes};
+    uint32_t hits{0};
+
+    auto origins() const -> vec3x4
+    {
+        return {gather([this](uint32_t k) { return rays[k].origin().x(); }),
+                gather([this](uint32_t k) { return rays[k].origin().y(); }),
+                gather([this](uint32_t k) { return rays[k].origin().z(); })};
+    }
+
+    auto inverse_directions() const -> vec3x4
+    {
+        double4 const one(1.0);
+
+        return {one / gather([this](uint32_t k) { return rays[k].direction().x(); }),
+                one / gather([this](uint32_t k) { return rays[k].direction().y(); }),
+                one / gather([this](uint32_t k) { return rays[k].direction().z(); })};
+    }
+
+    auto range_min() const -> double4 { return gather([this](uint32_t k) { return ranges[k].min; }); }
+
+    auto range_max() const -> double4 { return gather([this](uint32_t k) { return ranges[k].max; }); }
+
+private:
+
+    template <typename F>
+    static auto gather(F&& component) -> double4
+    {
+        return double4::load(std::array{component(0U), component(1U), component(2U), component(3U)});
+    }
+};
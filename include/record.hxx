@@ -2,9 +2,12 @@
 
 #include "ray.hxx" // point3
 
-#include <memory> // std::shared_ptr
+#include <cstdint> // uint32_t
 
-class material;
+/**
+ * @brief Index of a material in the material_table of the scene.
+ */
+using material_id = uint32_t;
 
 class hit_record
 {
@@ -12,7 +15,7 @@ public:
 
     point3 p;
     vec3 normal;
-    std::shared_ptr<material> mat_ptr;
+    material_id mat_id{0};
     double t{0.0};
     bool front_face{false};
 
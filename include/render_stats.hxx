@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm> // std::ranges::max
+#include <chrono>    // std::chrono::duration, std::chrono::nanoseconds, std::chrono::steady_clock
+#include <cstddef>   // std::size_t
+#include <cstdint>   // uint64_t
+#include <ostream>   // std::ostream
+#include <vector>    // std::vector
+
+/**
+ * @brief Counters and timers of one render thread, alone in its cache line so the threads never share one.
+ */
+struct alignas(64) thread_stats
+{
+    uint64_t tiles{0};
+    uint64_t primary_rays{0};
+    uint64_t shadow_rays{0};
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds intersect{0};
+    std::chrono::nanoseconds shade{0};
+    std::chrono::nanoseconds shadow{0};
+
+    auto operator+=(thread_stats const& other) -> thread_stats&
+    {
+        tiles += other.tiles;
+        primary_rays += other.primary_rays;
+        shadow_rays += other.shadow_rays;
+        busy += other.busy;
+        intersect += other.intersect;
+        shade += other.shade;
+        shadow += other.shadow;
+
+        return *this;
+    }
+};
+
+/**
+ * @brief What a render did, and how long each of its threads spent doing it.
+ * Intersection is the traversal of the primary rays, shadow the light loop tracing the shadow rays, and shading the
+ * rest of the work done at each hit.
+ */
+struct render_stats
+{
+    std::vector<thread_stats> threads;
+    std::chrono::nanoseconds wall{0};
+
+    auto total() const -> thread_stats
+    {
+        thread_stats sum;
+
+        for (auto const& thread : threads) { sum += thread; }
+
+        return sum;
+    }
+
+    auto rays() const -> uint64_t
+    {
+        auto const sum = total();
+
+        return sum.primary_rays + sum.shadow_rays;
+    }
+
+    auto mrays_per_second() const -> double
+    {
+        return wall.count() == 0 ? 0.0 : static_cast<double>(rays()) / std::chrono::duration<double, std::micro>(wall).count();
+    }
+
+    /**
+     * @brief The fraction of the wall time the threads spent rendering, 1 when none of them ever waits.
+     */
+    auto utilization() const -> double
+    {
+        if (threads.empty() || wall.count() == 0) { return 0.0; }
+
+        auto const thread_count = static_cast<double>(threads.size());
+
+        return static_cast<double>(total().busy.count()) / (static_cast<double>(wall.count()) * thread_count);
+    }
+
+    /**
+     * @brief The busy time of the busiest thread over the mean one, 1 for a perfect balance.
+     */
+    auto imbalance() const -> double
+    {
+        auto const sum = total().busy.count();
+
+        if (sum == 0) { return 1.0; }
+
+        auto const busiest = std::ranges::max(threads, {}, [](thread_stats const& t) { return t.busy; }).busy.count();
+
+        return static_cast<double>(busiest) * static_cast<double>(threads.size()) / static_cast<double>(sum);
+    }
+
+    /**
+     * @brief Writes the statistics as a single JSON object, times in seconds.
+     */
+    auto write_json(std::ostream& out) const -> void
+    {
+        auto const seconds = [](std::chrono::nanoseconds const time) { return std::chrono::duration<double>(time).count(); };
+        auto const sum = total();
+
+        out << "{\"wall\": " << seconds(wall) << ", \"rays\": " << rays() << ", \"mrays_per_second\": " << mrays_per_second()
+            << ", \"utilization\": " << utilization() << ", \"imbalance\": " << imbalance() << ", \"primary_rays\": "
+            << sum.primary_rays << ", \"shadow_rays\": " << sum.shadow_rays << ", \"intersect\": " << seconds(sum.intersect)
+            << ", \"shade\": " << seconds(sum.shade) << ", \"shadow\": " << seconds(sum.shadow) << ", \"threads\": [";
+
+        for (std::size_t k = 0; k < threads.size(); ++k)
+        {
+            out << (k == 0 ? "" : ", ") << "{\"tiles\": " << threads[k].tiles << ", \"busy\": " << seconds(threads[k].busy)
+                << '}';
+        }
+
+        out << "]}";
+    }
+};
+
+/**
+ * @brief Adds the time elapsed since the previous call, or since construction, to the given timer.
+ */
+class stage_timer
+{
+public:
+
+    auto lap(std::chrono::nanoseconds& timer) -> void
+    {
+        auto const now = std::chrono::steady_clock::now();
+        timer += now - m_last;
+        m_last = now;
+    }
+
+private:
+
+    std::chrono::steady_clock::time_point m_last{std::chrono::steady_clock::now()};
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint> // uint32_t, uint64_t
+
+/**
+ * @brief Small PCG32 generator (XSH RR variant), cheap enough to be created for every sample.
+ * Each render thread owns its samplers, and seeding them from the pixel and sample indices makes the
+ * image independent of the thread count and of the order in which the pixels are rendered.
+ */
+class sampler
+{
+public:
+
+    constexpr explicit sampler(uint64_t seed, uint64_t stream = 0) : m_increment((stream << 1U) | 1U)
+    {
+        next_u32();
+        m_state += seed;
+        next_u32();
+    }
+
+    /**
+     * @brief Creates the sampler of a given sample of a given pixel.
+     * @param seed   The seed of the whole image.
+     * @param pixel  The index of the pixel in the image.
+     * @param sample The index of the sample in the pixel.
+     * @return The sampler, always the same for the same arguments.
+     */
+    static constexpr auto for_sample(uint64_t seed, uint64_t pixel, uint64_t sample) -> sampler
+    {
+        return sampler(mix(seed ^ mix(pixel)), mix(sample + (pixel << 32U)));
+    }
+
+    constexpr auto next_u32() -> uint32_t
+    {
+        auto const old_state = m_state;
+        m_state = old_state * multiplier + m_increment;
+        auto const xorshifted = static_cast<uint32_t>(((old_state >> 18U) ^ old_state) >> 27U);
+        auto const rotation = static_cast<uint32_t>(old_state >> 59U);
+
+        return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31U));
+    }
+
+    /**
+     * @brief Returns a uniformly distributed number in [0,1).
+     */
+    constexpr auto next_double() -> double { return next_u32() * 0x1.0p-32; }
+
+private:
+
+    /**
+     * @brief SplitMix64 finalizer, spreads neighbouring indices over the whole seed space.
+     */
+    static constexpr auto mix(uint64_t value) -> uint64_t
+    {
+        value += 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27U)) * 0x94D049BB133111EBULL;
+
+        return value ^ (value >> 31U);
+    }
+
+    static constexpr uint64_t multiplier{6364136223846793005ULL};
+
+    uint64_t m_state{0};
+    uint64_t m_increment{1};
+};
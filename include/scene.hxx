@@ -0,0 +1,296 @@
+#pragma once
+
+#include "bvh.hxx"           // bvh
+#include "camera.hxx"        // camera
+#include "hittable_list.hxx" // hittable_list
+#include "light.hxx"         // light
+#include "material.hxx"      // material_table, lambertian, metal, dielectric
+#include "mesh.hxx"          // indexed_mesh, mesh
+#include "ply.hxx"           // load_ply
+#include "sphere.hxx"        // sphere
+#include "sphere_set.hxx"    // sphere_set
+
+#include <charconv>      // std::from_chars
+#include <chrono>        // std::chrono::milliseconds
+#include <cstdint>       // uint32_t, uint64_t
+#include <filesystem>    // std::filesystem::path
+#include <format>        // std::format
+#include <fstream>       // std::ifstream
+#include <memory>        // std::shared_ptr, std::make_shared
+#include <sstream>       // std::ostringstream
+#include <stdexcept>     // std::runtime_error
+#include <string>        // std::string
+#include <string_view>   // std::string_view
+#include <system_error>  // std::errc
+#include <unordered_map> // std::unordered_map
+#include <vector>        // std::vector
+
+enum class material_kind : uint32_t
+{
+    lambertian,
+    metal,
+    dielectric
+};
+
+/**
+ * @brief The parameters of a material, from which the material itself is made.
+ */
+struct material_description
+{
+    material_kind kind{material_kind::lambertian};
+    color albedo;
+    double fuzz{0.0};
+    double index_of_refraction{1.0};
+};
+
+struct mesh_reference
+{
+    std::filesystem::path path;
+    material_id mat_id{0};
+};
+
+/**
+ * @brief A scene as written in a scene file: the meshes are only referenced and nothing is built yet.
+ */
+struct scene_description
+{
+    camera view;
+    std::vector<light> lights;
+    std::vector<material_description> materials;
+    std::vector<sphere> spheres;
+    std::vector<mesh_reference> meshes;
+};
+
+/**
+ * @brief A scene ready to render: the materials are made and the geometry sits in its hierarchies.
+ * The description of the materials is kept so the scene can be cached.
+ */
+struct scene
+{
+    camera view;
+    std::vector<light> lights;
+    std::vector<material_description> material_descriptions;
+    material_table materials;
+    std::shared_ptr<sphere_set> spheres;
+    std::vector<std::shared_ptr<mesh>> meshes;
+
+    /**
+     * @brief The top-level hierarchy over the sphere set and the meshes, cheap to build since each is a single box.
+     */
+    auto world() const -> bvh
+    {
+        hittable_list objects;
+
+        if (spheres) { objects.add(spheres); }
+
+        for (auto const& m : meshes) { objects.add(m); }
+
+        return bvh(objects);
+    }
+};
+
+inline auto make_materials(std::vector<material_description> const& descriptions) -> material_table
+{
+    material_table materials;
+
+    for (auto const& description : descriptions)
+    {
+        switch (description.kind)
+        {
+        case material_kind::lambertian:
+            materials.emplace<lambertian>(description.albedo);
+            break;
+        case material_kind::metal:
+            materials.emplace<metal>(description.albedo, description.fuzz);
+            break;
+        case material_kind::dielectric:
+            materials.emplace<dielectric>(description.index_of_refraction);
+            break;
+        }
+    }
+
+    return materials;
+}
+
+/**
+ * @brief Loads the meshes of a description and builds the hierarchies of its geometry.
+ */
+inline auto build_scene(scene_description description) -> scene
+{
+    scene result;
+    result.view = description.view;
+    result.lights = std::move(description.lights);
+    result.materials = make_materials(description.materials);
+    result.material_descriptions = std::move(description.materials);
+
+    if (!description.spheres.empty()) { result.spheres = std::make_shared<sphere_set>(std::move(description.spheres)); }
+
+    for (auto const& reference : description.meshes)
+    {
+        auto data = std::make_shared<indexed_mesh const>(load_ply(reference.path));
+        result.meshes.push_back(std::make_shared<mesh>(std::move(data), reference.mat_id));
+    }
+
+    return result;
+}
+
+/**
+ * @brief Parses a scene file. Each line holds one statement, and # starts a comment:
+ *
+ *     camera <field> <value>                   aspect_ratio, image_width, samples_per_pixel, max_depth, seed,
+ *                                              samples_per_pass, min_samples, noise_threshold or time_budget in
+ *                                              milliseconds
+ *     light <x y z> <r g b> <intensity>
+ *     material <name> lambertian <r g b>
+ *     material <name> metal <r g b> <fuzz>
+ *     material <name> dielectric <index of refraction>
+ *     sphere <x y z> <radius> <material>
+ *     mesh <ply path> <material>               the path is relative to the directory of the scene file
+ *
+ * Materials must be declared before being used, colors are linear with components in [0, 1].
+ * @param text      The content of the scene file.
+ * @param directory The directory of the scene file.
+ * @return The description of the scene.
+ */
+inline auto parse_scene(std::string_view text, std::filesystem::path const& directory) -> scene_description
+{
+    scene_description description;
+    std::unordered_map<std::string, material_id> material_names;
+    std::size_t line_number{0};
+
+    for (std::size_t begin = 0; begin < text.size();)
+    {
+        auto end = text.find('\n', begin);
+        end = end == std::string_view::npos ? text.size() : end;
+        auto line = text.substr(begin, end - begin);
+        begin = end + 1;
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+
+        auto const words = ply_split_words(line);
+        std::size_t next{0};
+        auto const fail = [line_number](std::string_view message) -> std::runtime_error {
+            return std::runtime_error(std::format("scene line {}: {}", line_number, message));
+        };
+        auto const word = [&]() -> std::string_view {
+            if (next == words.size()) [[unlikely]] { throw fail("missing value"); }
+            return words[next++];
+        };
+        auto const number = [&](auto value) {
+            auto const value_text = word();
+            auto const [ptr, ec] = std::from_chars(value_text.data(), value_text.data() + value_text.size(), value);
+
+            if (ec != std::errc() || ptr != value_text.data() + value_text.size()) [[unlikely]]
+            {
+                throw fail(std::format("invalid number '{}'", value_text));
+            }
+
+            return value;
+        };
+        auto const real = [&] { return number(0.0); };
+        auto const integer = [&] { return number(uint32_t{0}); };
+        auto const vector = [&] {
+            auto const x = real();
+            auto const y = real();
+            auto const z = real();
+
+            return vec3{x, y, z};
+        };
+        auto const material = [&] {
+            auto const it = material_names.find(std::string(word()));
+
+            if (it == material_names.end()) [[unlikely]] { throw fail("unknown material"); }
+
+            return it->second;
+        };
+
+        if (words.empty()) { continue; }
+
+        auto const statement = word();
+
+        if (statement == "camera")
+        {
+            auto const field = word();
+            auto& view = description.view;
+
+            if (field == "aspect_ratio") { view.aspect_ratio = real(); }
+            else if (field == "image_width") { view.image_width = integer(); }
+            else if (field == "samples_per_pixel") { view.samples_per_pixel = integer(); }
+            else if (field == "max_depth") { view.max_depth = integer(); }
+            else if (field == "seed") { view.seed = number(uint64_t{0}); }
+            else if (field == "samples_per_pass") { view.samples_per_pass = integer(); }
+            else if (field == "min_samples") { view.min_samples = integer(); }
+            else if (field == "noise_threshold") { view.noise_threshold = real(); }
+            else if (field == "time_budget") { view.time_budget = std::chrono::milliseconds(integer()); }
+            else [[unlikely]] { throw fail(std::format("unknown camera field '{}'", field)); }
+        }
+        else if (statement == "light")
+        {
+            auto const position = vector();
+            auto const light_color = vector();
+            description.lights.push_back(light{position, light_color, real()});
+        }
+        else if (statement == "material")
+        {
+            auto const name = std::string(word());
+            auto const kind = word();
+            material_description m;
+
+            if (kind == "lambertian")
+            {
+                m.kind = material_kind::lambertian;
+                m.albedo = vector();
+            }
+            else if (kind == "metal")
+            {
+                m.kind = material_kind::metal;
+                m.albedo = vector();
+                m.fuzz = real();
+            }
+            else if (kind == "dielectric")
+            {
+                m.kind = material_kind::dielectric;
+                m.index_of_refraction = real();
+            }
+            else [[unlikely]] { throw fail(std::format("unknown material kind '{}'", kind)); }
+
+            auto const id = static_cast<material_id>(description.materials.size());
+
+            if (!material_names.emplace(name, id).second) [[unlikely]] { throw fail("material declared twice"); }
+
+            description.materials.push_back(m);
+        }
+        else if (statement == "sphere")
+        {
+            auto const center = vector();
+            auto const radius = real();
+            description.spheres.emplace_back(center, radius, material());
+        }
+        else if (statement == "mesh")
+        {
+            auto const path = directory / std::filesystem::path(word());
+            description.meshes.push_back({path, material()});
+        }
+        else [[unlikely]] { throw fail(std::format("unknown statement '{}'", statement)); }
+
+        if (next != words.size()) [[unlikely]] { throw fail("unexpected values at the end of the line"); }
+    }
+
+    return description;
+}
+
+inline auto read_text_file(std::filesystem::path const& path) -> std::string
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file)
+    {
+        throw std::filesystem::filesystem_error("cannot open file", path,
+                                                std::make_error_code(std::errc::no_such_file_or_directory));
+    }
+
+    std::ostringstream text;
+    text << file.rdbuf();
+
+    return std::move(text).str();
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include "bvh.hxx"         // bvh_node, bvh_tree
+#include "mapped_file.hxx" // mapped_file
+#include "mesh.hxx"        // indexed_mesh, mesh
+#include "scene.hxx"       // scene, scene_description, parse_scene, build_scene, make_materials
+#include "sphere.hxx"      // sphere, sphere4
+#include "sphere_set.hxx"  // sphere_set
+#include "triangle.hxx"    // triangle4
+
+#include <algorithm>   // std::max, std::ranges::all_of, std::ranges::equal
+#include <array>       // std::array
+#include <chrono>      // std::chrono::milliseconds
+#include <cstddef>     // std::byte, std::size_t
+#include <cstdint>     // uint32_t, uint64_t, int64_t
+#include <cstring>     // std::memcpy
+#include <filesystem>  // std::filesystem::path, std::filesystem::rename
+#include <iostream>    // std::clog
+#include <memory>      // std::make_shared
+#include <optional>    // std::optional
+#include <span>        // std::span
+#include <stdexcept>   // std::runtime_error
+#include <string_view> // std::string_view
+#include <type_traits> // std::is_trivially_copyable_v
+#include <vector>      // std::vector
+
+// The first bytes of every scene cache.
+static constexpr std::array<char, 8> scene_cache_magic{'R', 'A', 'Y', 'O', 'N', 'S', 'S', 'C'};
+// Changes with the layout written by write_scene_cache.
+static constexpr uint32_t scene_cache_version{1};
+// Appended to the path of a scene file to get the path of its cache.
+static constexpr std::string_view scene_cache_extension{".cache"};
+
+/**
+ * @brief Appends values to a byte buffer as they are laid out in memory, arrays preceded by their size.
+ */
+class scene_cache_writer
+{
+public:
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    auto write(T const& value) -> void
+    {
+        auto const bytes = std::as_bytes(std::span(&value, 1));
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    auto write_array(std::span<T const> values) -> void
+    {
+        write(static_cast<uint64_t>(values.size()));
+        auto const bytes = std::as_bytes(values);
+        m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+    auto bytes() const -> std::span<std::byte const> { return m_bytes; }
+
+private:
+
+    std::vector<std::byte> m_bytes;
+};
+
+/**
+ * @brief Reads back what scene_cache_writer wrote, throwing if the data ends too early.
+ */
+class scene_cache_reader
+{
+public:
+
+    explicit scene_cache_reader(std::span<std::byte const> data) : m_data(data) {}
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    auto read() -> T
+    {
+        T value;
+        std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+
+        return value;
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    auto read_array() -> std::vector<T>
+    {
+        auto const count = read<uint64_t>();
+
+        if (count > remaining() / sizeof(T)) [[unlikely]] { throw std::runtime_error("truncated scene cache"); }
+
+        std::vector<T> values(count);
+        std::memcpy(values.data(), take(count * sizeof(T)).data(), count * sizeof(T));
+
+        return values;
+    }
+
+    auto remaining() const -> std::size_t { return m_data.size() - m_offset; }
+
+    auto rest() const -> std::span<std::byte const> { return m_data.subspan(m_offset); }
+
+private:
+
+    auto take(std::size_t size) -> std::span<std::byte const>
+    {
+        if (size > remaining()) [[unlikely]] { throw std::runtime_error("truncated scene cache"); }
+
+        auto const bytes = m_data.subspan(m_offset, size);
+        m_offset += size;
+
+        return bytes;
+    }
+
+    std::span<std::byte const> m_data;
+    std::size_t m_offset{0};
+};
+
+/**
+ * @brief FNV-1a hash of the scene file and of the size and modification time of each mesh it references.
+ */
+inline auto scene_fingerprint(std::string_view text, scene_description const& description) -> uint64_t
+{
+    auto hash = uint64_t{0xcbf29ce484222325};
+    auto const add = [&hash](std::span<std::byte const> bytes) {
+        for (auto const byte : bytes) { hash = (hash ^ static_cast<uint64_t>(byte)) * 0x100000001b3; }
+    };
+    auto const add_value = [&add](auto const value) { add(std::as_bytes(std::span(&value, 1))); };
+
+    add(std::as_bytes(std::span(text)));
+
+    for (auto const& reference : description.meshes)
+    {
+        add_value(static_cast<uint64_t>(std::filesystem::file_size(reference.path)));
+        add_value(static_cast<int64_t>(std::filesystem::last_write_time(reference.path).time_since_epoch().count()));
+    }
+
+    return hash;
+}
+
+/**
+ * @brief FNV-1a hash of the payload of a cache, taken eight bytes at a time so that checking it stays cheap next to
+ * the copies of the load.
+ */
+inline auto scene_cache_checksum(std::span<std::byte const> bytes) -> uint64_t
+{
+    auto hash = uint64_t{0xcbf29ce484222325};
+    std::size_t k{0};
+
+    for (; k + sizeof(uint64_t) <= bytes.size(); k += sizeof(uint64_t))
+    {
+        uint64_t word{0};
+        std::memcpy(&word, bytes.data() + k, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3;
+    }
+
+    for (; k < bytes.size(); ++k) { hash = (hash ^ static_cast<uint64_t>(bytes[k])) * 0x100000001b3; }
+
+    return hash;
+}
+
+/**
+ * @brief Checks that a restored hierarchy has the shape the traversals rely on: children stored after their parent
+ * and never deeper than the traversal stack, leaves holding at most one block of width indices starting on a block
+ * boundary, and indices that refer to existing primitives or pad a block.
+ */
+inline auto valid_tree(std::span<bvh_node const> nodes, std::span<uint32_t const> indices, std::size_t primitives,
+                       uint32_t width) -> bool
+{
+    if (indices.size() % width != 0) { return false; }
+
+    std::vector<uint32_t> depths(nodes.size(), 0);
+
+    for (std::size_t current = 0; current < nodes.size(); ++current)
+    {
+        auto const& node = nodes[current];
+
+        if (node.axis >= 3 || depths[current] + 1 >= bvh_tree::max_depth) { return false; }
+
+        if (node.count == 0)
+        {
+            if (current + 1 >= nodes.size() || node.offset <= current || node.offset >= nodes.size()) { return false; }
+
+            depths[current + 1] = std::max(depths[current + 1], depths[current] + 1);
+            depths[node.offset] = std::max(depths[node.offset], depths[current] + 1);
+        }
+        else if (node.count > width || node.offset % width != 0 || node.offset + uint64_t{width} > indices.size())
+        {
+            return false;
+        }
+    }
+
+    return std::ranges::all_of(indices, [primitives](uint32_t const index) {
+        return index == bvh_tree::invalid_index || index < primitives;
+    });
+}
+
+inline auto write_tree(scene_cache_writer& out, bvh_tree const& tree) -> void
+{
+    out.write_array(tree.nodes());
+    out.write_array(tree.indices());
+}
+
+inline auto read_tree(scene_cache_reader& in, std::size_t primitives, uint32_t width) -> bvh_tree
+{
+    auto nodes = in.read_array<bvh_node>();
+    auto indices = in.read_array<uint32_t>();
+
+    if (!valid_tree(nodes, indices, primitives, width)) [[unlikely]]
+    {
+        throw std::runtime_error("invalid scene cache hierarchy");
+    }
+
+    return {std::move(nodes), std::move(indices)};
+}
+
+/**
+ * @brief Writes the cache of a built scene: everything a scene file describes, plus the hierarchies of its geometry.
+ * Loading it only copies arrays out of a memory mapping, nothing is parsed nor built again. The header holds the
+ * magic, the version, the size of a node, the fingerprint tying the cache to the scene file and meshes it was made
+ * from, and the checksum of the payload that follows. The file is first written under a temporary name and renamed
+ * once complete, so an interrupted write never leaves a partial cache behind.
+ */
+inline auto write_scene_cache(scene const& s, std::filesystem::path const& path, uint64_t fingerprint) -> void
+{
+    scene_cache_writer out;
+    out.write(s.view.aspect_ratio);
+    out.write(s.view.image_width);
+    out.write(s.view.samples_per_pixel);
+    out.write(s.view.max_depth);
+    out.write(s.view.samples_per_pass);
+    out.write(s.view.min_samples);
+    out.write(s.view.seed);
+    out.write(s.view.noise_threshold);
+    out.write(static_cast<int64_t>(s.view.time_budget.count()));
+
+    out.write_array(std::span<light const>(s.lights));
+    out.write(static_cast<uint64_t>(s.material_descriptions.size()));
+
+    for (auto const& m : s.material_descriptions)
+    {
+        out.write(m.kind);
+        out.write(m.albedo);
+        out.write(m.fuzz);
+        out.write(m.index_of_refraction);
+    }
+
+    auto const spheres = s.spheres ? s.spheres->spheres() : std::span<sphere const>{};
+    out.write(static_cast<uint64_t>(spheres.size()));
+
+    for (auto const& sp : spheres)
+    {
+        out.write(sp.center());
+        out.write(sp.radius());
+        out.write(sp.mat_id());
+    }
+
+    write_tree(out, s.spheres ? s.spheres->tree() : bvh_tree{});
+    out.write(static_cast<uint64_t>(s.meshes.size()));
+
+    for (auto const& m : s.meshes)
+    {
+        out.write(m->mat_id());
+        out.write_array(std::span<point3 const>(m->data().vertices));
+        out.write_array(std::span<std::array<uint32_t, 3> const>(m->data().faces));
+        write_tree(out, m->tree());
+    }
+
+    scene_cache_writer header;
+    header.write(scene_cache_magic);
+    header.write(scene_cache_version);
+    header.write(static_cast<uint32_t>(sizeof(bvh_node)));
+    header.write(fingerprint);
+    header.write(scene_cache_checksum(out.bytes()));
+
+    auto temporary = path;
+    temporary += ".tmp";
+
+    {
+        auto file = mapped_file::create(temporary, header.bytes().size() + out.bytes().size());
+        std::memcpy(file.data().data(), header.bytes().data(), header.bytes().size());
+        std::memcpy(file.data().data() + header.bytes().size(), out.bytes().data(), out.bytes().size());
+    }
+
+    std::filesystem::rename(temporary, path);
+}
+
+/**
+ * @brief Loads a scene from its cache.
+ * @param path        The cache file.
+ * @param fingerprint The fingerprint the cache must have, any if not given.
+ * @return The scene, or nothing if the cache is from another version or for other files.
+ */
+inline auto read_scene_cache(std::filesystem::path const& path, std::optional<uint64_t> fingerprint = {})
+    -> std::optional<scene>
+{
+    auto const file = mapped_file::open(path);
+    scene_cache_reader in(file.data());
+
+    if (in.read<std::array<char, 8>>() != scene_cache_magic || in.read<uint32_t>() != scene_cache_version
+        || in.read<uint32_t>() != sizeof(bvh_node))
+    {
+        return std::nullopt;
+    }
+
+    if (auto const stored = in.read<uint64_t>(); fingerprint && stored != *fingerprint) { return std::nullopt; }
+
+    // A cache loaded directly has no fingerprint to compare, the checksum still catches a damaged file.
+    if (in.read<uint64_t>() != scene_cache_checksum(in.rest())) [[unlikely]]
+    {
+        throw std::runtime_error("corrupt scene cache");
+    }
+
+    scene s;
+    s.view.aspect_ratio = in.read<double>();
+    s.view.image_width = in.read<uint32_t>();
+    s.view.samples_per_pixel = in.read<uint32_t>();
+    s.view.max_depth = in.read<uint32_t>();
+    s.view.samples_per_pass = in.read<uint32_t>();
+    s.view.min_samples = in.read<uint32_t>();
+    s.view.seed = in.read<uint64_t>();
+    s.view.noise_threshold = in.read<double>();
+    s.view.time_budget = std::chrono::milliseconds(in.read<int64_t>());
+
+    s.lights = in.read_array<light>();
+    s.material_descriptions.resize(in.read<uint64_t>());
+
+    for (auto& m : s.material_descriptions)
+    {
+        m.kind = in.read<material_kind>();
+        m.albedo = in.read<color>();
+        m.fuzz = in.read<double>();
+        m.index_of_refraction = in.read<double>();
+
+        if (m.kind > material_kind::dielectric) [[unlikely]] { throw std::runtime_error("invalid scene cache material"); }
+    }
+
+    s.materials = make_materials(s.material_descriptions);
+    auto const valid_material = [&s](material_id const id) {
+        if (id >= s.material_descriptions.size()) [[unlikely]] { throw std::runtime_error("invalid scene cache material"); }
+        return id;
+    };
+
+    std::vector<sphere> spheres;
+    auto const sphere_count = in.read<uint64_t>();
+
+    for (uint64_t k = 0; k < sphere_count; ++k)
+    {
+        auto const center = in.read<point3>();
+        auto const radius = in.read<double>();
+        spheres.emplace_back(center, radius, valid_material(in.read<material_id>()));
+    }
+
+    auto sphere_tree = read_tree(in, spheres.size(), sphere4::width);
+
+    if (!spheres.empty()) { s.spheres = std::make_shared<sphere_set>(std::move(spheres), std::move(sphere_tree)); }
+
+    auto const mesh_count = in.read<uint64_t>();
+
+    for (uint64_t k = 0; k < mesh_count; ++k)
+    {
+        auto const mat_id = valid_material(in.read<material_id>());
+        indexed_mesh data;
+        data.vertices = in.read_array<point3>();
+        data.faces = in.read_array<std::array<uint32_t, 3>>();
+
+        if (!std::ranges::all_of(data.faces, [&data](auto const& face) {
+                return std::ranges::all_of(face, [&data](uint32_t const v) { return v < data.vertices.size(); });
+            })) [[unlikely]]
+        {
+            throw std::runtime_error("invalid scene cache vertex index");
+        }
+
+        auto tree = read_tree(in, data.faces.size(), triangle4::width);
+        auto shared_data = std::make_shared<indexed_mesh const>(std::move(data));
+        s.meshes.push_back(std::make_shared<mesh>(std::move(shared_data), mat_id, std::move(tree)));
+    }
+
+    return s;
+}
+
+inline auto scene_cache_path(std::filesystem::path const& scene_path) -> std::filesystem::path
+{
+    auto path = scene_path;
+    path += scene_cache_extension;
+
+    return path;
+}
+
+/**
+ * @brief Loads a scene file, or a scene cache given directly.
+ * A scene file is always parsed, which is cheap, but its meshes are only loaded and its hierarchies built when
+ * the cache next to it is missing or stale, in which case the cache is written again.
+ */
+inline auto load_scene(std::filesystem::path const& path) -> scene
+{
+    if (path.extension() == scene_cache_extension)
+    {
+        auto cached = read_scene_cache(path);
+
+        if (!cached) [[unlikely]] { throw std::runtime_error("unsupported scene cache version"); }
+
+        return std::move(*cached);
+    }
+
+    auto const text = read_text_file(path);
+    auto description = parse_scene(text, path.parent_path());
+    auto const fingerprint = scene_fingerprint(text, description);
+    auto const cache_path = scene_cache_path(path);
+
+    if (std::filesystem::exists(cache_path))
+    {
+        try
+        {
+            if (auto cached = read_scene_cache(cache_path, fingerprint)) { return std::move(*cached); }
+        }
+        catch (std::runtime_error const& error)
+        {
+            std::clog << "Ignoring the scene cache: " << error.what() << '\n';
+        }
+    }
+
+    auto result = build_scene(std::move(description));
+
+    try
+    {
+        write_scene_cache(result, cache_path, fingerprint);
+    }
+    catch (std::filesystem::filesystem_error const& error)
+    {
+        std::clog << "Scene cache not written: " << error.what() << '\n';
+    }
+
+    return result;
+}
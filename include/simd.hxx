@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm> // std::ranges::copy
+#include <array>     // std::array
+#include <bit>       // std::bit_cast, std::countr_zero
+#include <cmath>     // std::sqrt
+#include <cstddef>   // std::size_t
+#include <cstdint>   // uint32_t, uint64_t, int64_t
+
+// Defining RAYONS_NO_SIMD selects the portable scalar implementation.
+#if defined(RAYONS_NO_SIMD)
+#elif defined(__AVX__)
+#include <immintrin.h> // __m256d
+#define RAYONS_SIMD_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h> // __m128d
+#define RAYONS_SIMD_SSE2 1
+#endif
+
+/**
+ * @brief Four doubles processed at once: one AVX register, two SSE2 registers, or a plain array elsewhere.
+ * Comparisons return lane masks of the same type, with all the bits of a lane set when the comparison holds.
+ */
+class double4
+{
+public:
+
+    static constexpr std::size_t width{4};
+
+    double4() = default;
+
+    explicit double4(double value)
+    {
+#if defined(RAYONS_SIMD_AVX)
+        m_v = _mm256_set1_pd(value);
+#elif defined(RAYONS_SIMD_SSE2)
+        m_lo = _mm_set1_pd(value);
+        m_hi = m_lo;
+#else
+        m_v = {value, value, value, value};
+#endif
+    }
+
+    static auto load(double const* values) -> double4
+    {
+        double4 result;
+#if defined(RAYONS_SIMD_AVX)
+        result.m_v = _mm256_loadu_pd(values);
+#elif defined(RAYONS_SIMD_SSE2)
+        result.m_lo = _mm_loadu_pd(values);
+        result.m_hi = _mm_loadu_pd(values + 2);
+#else
+        result.m_v = {values[0], values[1], values[2], values[3]};
+#endif
+        return result;
+    }
+
+    static auto load(std::array<double, width> const& values) -> double4 { return load(values.data()); }
+
+    auto store(double* values) const -> void
+    {
+#if defined(RAYONS_SIMD_AVX)
+        _mm256_storeu_pd(values, m_v);
+#elif defined(RAYONS_SIMD_SSE2)
+        _mm_storeu_pd(values, m_lo);
+        _mm_storeu_pd(values + 2, m_hi);
+#else
+        std::ranges::copy(m_v, values);
+#endif
+    }
+
+    auto to_array() const -> std::array<double, width>
+    {
+        std::array<double, width> values{};
+        store(values.data());
+
+        return values;
+    }
+
+    /**
+     * @brief Packs the sign bit of each lane, which is set in every true lane of a mask, lane 0 in bit 0.
+     */
+    auto mask() const -> uint32_t
+    {
+#if defined(RAYONS_SIMD_AVX)
+        return static_cast<uint32_t>(_mm256_movemask_pd(m_v));
+#elif defined(RAYONS_SIMD_SSE2)
+        return static_cast<uint32_t>(_mm_movemask_pd(m_lo) | (_mm_movemask_pd(m_hi) << 2));
+#else
+        uint32_t bits{0};
+
+        for (std::size_t k = 0; k < width; ++k) { bits |= static_cast<uint32_t>(std::bit_cast<uint64_t>(m_v[k]) >> 63U) << k; }
+
+        return bits;
+#endif
+    }
+
+#if defined(RAYONS_SIMD_AVX)
+#define RAYONS_DOUBLE4_BINARY(name, avx, sse, scalar)               \
+    friend auto name(double4 const& a, double4 const& b) -> double4 \
+    {                                                               \
+        double4 result;                                             \
+        result.m_v = avx;                                           \
+        return result;                                              \
+    }
+#elif defined(RAYONS_SIMD_SSE2)
+#define RAYONS_DOUBLE4_BINARY(name, avx, sse, scalar)               \
+    friend auto name(double4 const& a, double4 const& b) -> double4 \
+    {                                                               \
+        double4 result;                                             \
+        result.m_lo = sse(a.m_lo, b.m_lo);                          \
+        result.m_hi = sse(a.m_hi, b.m_hi);                          \
+        return result;                                              \
+    }
+#else
+#define RAYONS_DOUBLE4_BINARY(name, avx, sse, scalar)                       \
+    friend auto name(double4 const& a, double4 const& b) -> double4         \
+    {                                                                       \
+        double4 result;                                                     \
+        for (std::size_t k = 0; k < width; ++k) { result.m_v[k] = scalar; } \
+        return result;                                                      \
+    }
+#endif
+
+    RAYONS_DOUBLE4_BINARY(operator+, _mm256_add_pd(a.m_v, b.m_v), _mm_add_pd, a.m_v[k] + b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(operator-, _mm256_sub_pd(a.m_v, b.m_v), _mm_sub_pd, a.m_v[k] - b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(operator*, _mm256_mul_pd(a.m_v, b.m_v), _mm_mul_pd, a.m_v[k] * b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(operator/, _mm256_div_pd(a.m_v, b.m_v), _mm_div_pd, a.m_v[k] / b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(min, _mm256_min_pd(a.m_v, b.m_v), _mm_min_pd, a.m_v[k] < b.m_v[k] ? a.m_v[k] : b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(max, _mm256_max_pd(a.m_v, b.m_v), _mm_max_pd, a.m_v[k] > b.m_v[k] ? a.m_v[k] : b.m_v[k])
+    RAYONS_DOUBLE4_BINARY(operator<, _mm256_cmp_pd(a.m_v, b.m_v, _CMP_LT_OQ), _mm_cmplt_pd, lane_mask(a.m_v[k] < b.m_v[k]))
+    RAYONS_DOUBLE4_BINARY(operator<=, _mm256_cmp_pd(a.m_v, b.m_v, _CMP_LE_OQ), _mm_cmple_pd, lane_mask(a.m_v[k] <= b.m_v[k]))
+    RAYONS_DOUBLE4_BINARY(operator>, _mm256_cmp_pd(a.m_v, b.m_v, _CMP_GT_OQ), _mm_cmpgt_pd, lane_mask(a.m_v[k] > b.m_v[k]))
+    RAYONS_DOUBLE4_BINARY(operator>=, _mm256_cmp_pd(a.m_v, b.m_v, _CMP_GE_OQ), _mm_cmpge_pd, lane_mask(a.m_v[k] >= b.m_v[k]))
+    RAYONS_DOUBLE4_BINARY(operator&, _mm256_and_pd(a.m_v, b.m_v), _mm_and_pd,
+                          std::bit_cast<double>(std::bit_cast<uint64_t>(a.m_v[k]) & std::bit_cast<uint64_t>(b.m_v[k])))
+    RAYONS_DOUBLE4_BINARY(operator|, _mm256_or_pd(a.m_v, b.m_v), _mm_or_pd,
+                          std::bit_cast<double>(std::bit_cast<uint64_t>(a.m_v[k]) | std::bit_cast<uint64_t>(b.m_v[k])))
+
+#undef RAYONS_DOUBLE4_BINARY
+
+    /**
+     * @brief Picks the lanes of a where the mask is set, and the lanes of b elsewhere.
+     */
+    friend auto select(double4 const& mask, double4 const& a, double4 const& b) -> double4
+    {
+        double4 result;
+#if defined(RAYONS_SIMD_AVX)
+        result.m_v = _mm256_blendv_pd(b.m_v, a.m_v, mask.m_v);
+#elif defined(RAYONS_SIMD_SSE2)
+        result.m_lo = _mm_or_pd(_mm_and_pd(mask.m_lo, a.m_lo), _mm_andnot_pd(mask.m_lo, b.m_lo));
+        result.m_hi = _mm_or_pd(_mm_and_pd(mask.m_hi, a.m_hi), _mm_andnot_pd(mask.m_hi, b.m_hi));
+#else
+        for (std::size_t k = 0; k < width; ++k) { result.m_v[k] = std::bit_cast<int64_t>(mask.m_v[k]) < 0 ? a.m_v[k] : b.m_v[k]; }
+#endif
+        return result;
+    }
+
+    friend auto sqrt(double4 const& a) -> double4
+    {
+        double4 result;
+#if defined(RAYONS_SIMD_AVX)
+        result.m_v = _mm256_sqrt_pd(a.m_v);
+#elif defined(RAYONS_SIMD_SSE2)
+        result.m_lo = _mm_sqrt_pd(a.m_lo);
+        result.m_hi = _mm_sqrt_pd(a.m_hi);
+#else
+        for (std::size_t k = 0; k < width; ++k) { result.m_v[k] = std::sqrt(a.m_v[k]); }
+#endif
+        return result;
+    }
+
+private:
+
+    static auto lane_mask(bool value) -> double { return std::bit_cast<double>(value ? ~uint64_t{0} : uint64_t{0}); }
+
+#if defined(RAYONS_SIMD_AVX)
+    __m256d m_v;
+#elif defined(RAYONS_SIMD_SSE2)
+    __m128d m_lo;
+    __m128d m_hi;
+#else
+    std::array<double, width> m_v;
+#endif
+};
+
+/**
+ * @brief Three double4, one per axis: four vectors in structure-of-arrays layout.
+ */
+struct vec3x4
+{
+    double4 x;
+    double4 y;
+    double4 z;
+};
+
+inline auto operator-(vec3x4 const& u, vec3x4 const& v) -> vec3x4 { return {u.x - v.x, u.y - v.y, u.z - v.z}; }
+
+inline auto dot(vec3x4 const& u, vec3x4 const& v) -> double4 { return u.x * v.x + u.y * v.y + u.z * v.z; }
+
+inline auto cross(vec3x4 const& u, vec3x4 const& v) -> vec3x4
+{
+    return {u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x};
+}
+
+/**
+ * @brief Iterates over the set bits of a lane mask, from lane 0.
+ */
+template <typename F>
+auto for_each_lane(uint32_t lanes, F&& fn) -> void
+{
+    while (lanes != 0)
+    {
+        fn(static_cast<uint32_t>(std::countr_zero(lanes)));
+        lanes &= lanes - 1;
+    }
+}
+
+/**
+ * @brief Picks the nearest of the valid lanes, the first one on ties.
+ * @param valid    The mask of the lanes that hold a hit.
+ * @param distance The distance of the hit of each lane.
+ * @param t        Set to the distance of the nearest hit, if any.
+ * @return The nearest lane, or double4::width if no lane is valid.
+ */
+inline auto closest_lane(uint32_t valid, double4 const& distance, double& t) -> uint32_t
+{
+    if (valid == 0) { return double4::width; }
+
+    auto const distances = distance.to_array();
+    auto lane = static_cast<uint32_t>(std::countr_zero(valid));
+
+    for_each_lane(valid & (valid - 1), [&distances, &lane](uint32_t const k) {
+        if (distances[k] < distances[lane]) { lane = k; }
+    });
+    t = distances[lane];
+
+    return lane;
+}
@@ -1,15 +1,75 @@
 #pragma once
 
 #include "hittable.hxx" // hittable
+#include "simd.hxx"     // double4, vec3x4, closest_lane
 #include "vec3.hxx"     // vec3
 
+#include <array>   // std::array
+#include <cstdint> // uint32_t
+#include <limits>  // std::numeric_limits
+#include <tuple>   // std::tie, std::tuple
+
+/**
+ * @brief Four spheres in structure-of-arrays layout, tested against one ray at once.
+ * Unused lanes keep a NaN center, which fails every comparison.
+ */
+struct sphere4
+{
+    static constexpr uint32_t width{double4::width};
+    static constexpr auto unused = std::numeric_limits<double>::quiet_NaN();
+
+    std::array<double, width> center_x{unused, unused, unused, unused};
+    std::array<double, width> center_y{unused, unused, unused, unused};
+    std::array<double, width> center_z{unused, unused, unused, unused};
+    std::array<double, width> radius{};
+    std::array<uint32_t, width> index{~0U, ~0U, ~0U, ~0U};
+
+    auto set(uint32_t lane, point3 const& center, double sphere_radius, uint32_t sphere_index) -> void
+    {
+        std::tie(center_x[lane], center_y[lane], center_z[lane]) = std::tuple(center.x(), center.y(), center.z());
+        radius[lane] = sphere_radius;
+        index[lane] = sphere_index;
+    }
+
+    /**
+     * @brief Quadratic test of the four spheres, the same arithmetic as sphere::hit.
+     * @param r            The ray to test.
+     * @param ray_interval The parametric range to accept.
+     * @param t            Set to the distance of the closest hit, if any.
+     * @return The lane of the closest hit, or width if there is none.
+     */
+    auto intersect(ray const& r, interval const& ray_interval, double& t) const -> uint32_t
+    {
+        vec3x4 const direction{double4(r.direction().x()), double4(r.direction().y()), double4(r.direction().z())};
+        vec3x4 const origin{double4(r.origin().x()), double4(r.origin().y()), double4(r.origin().z())};
+        vec3x4 const center{double4::load(center_x), double4::load(center_y), double4::load(center_z)};
+        auto const radii = double4::load(radius);
+
+        auto const oc = origin - center;
+        auto const a = double4(r.direction().length_squared());
+        auto const half_b = dot(oc, direction);
+        auto const c = dot(oc, oc) - radii * radii;
+        auto const discriminant = half_b * half_b - a * c;
+        auto const zero = double4(0.0);
+        auto const sqrtd = sqrt(max(discriminant, zero));
+
+        auto const near = (zero - half_b - sqrtd) / a;
+        auto const far = (zero - half_b + sqrtd) / a;
+        auto const t_min = double4(ray_interval.min);
+        auto const t_max = double4(ray_interval.max);
+        auto const near_valid = (near >= t_min) & (near <= t_max);
+        auto const far_valid = (far >= t_min) & (far <= t_max);
+        auto const valid = (discriminant > zero) & (near_valid | far_valid);
+
+        return closest_lane(valid.mask(), select(near_valid, near, far), t);
+    }
+};
+
 class sphere : public hittable
 {
 public:
 
-    sphere(point3 center, double radius, std::shared_ptr<material> material_ptr)
-        : m_center(center), m_radius(radius), m_material_ptr(std::move(material_ptr))
-    {}
+    sphere(point3 center, double radius, material_id mat_id) : m_center(center), m_radius(radius), m_mat_id(mat_id) {}
 
     auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
     {
@@ -26,7 +86,7 @@ public:
 
             if (!ray_interval.contains(root))
             {
-                root = (-half_b + root) / a;
+                root = (-half_b + sqrtd) / a;
 
                 if (!ray_interval.contains(root)) { return false; }
             }
@@ -35,7 +95,7 @@ public:
             rec.p = r.at(rec.t);
             auto const outward_normal = (rec.p - m_center) / m_radius;
             rec.set_face_normal(r, outward_normal);
-            rec.mat_ptr = m_material_ptr;
+            rec.mat_id = m_mat_id;
 
             return true;
         }
@@ -43,9 +103,22 @@ public:
         return false;
     }
 
+    auto center() const -> point3 { return m_center; }
+
+    auto radius() const -> double { return m_radius; }
+
+    auto mat_id() const -> material_id { return m_mat_id; }
+
+    auto bounding_box() const -> aabb override
+    {
+        auto const extent = vec3(m_radius, m_radius, m_radius);
+
+        return {m_center - extent, m_center + extent};
+    }
+
 private:
 
     point3 m_center;
     double m_radius;
-    std::shared_ptr<material> m_material_ptr;
+    material_id m_mat_id;
 };
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "bvh.hxx"      // bvh_tree
+#include "hittable.hxx" // hittable
+#include "simd.hxx"     // for_each_lane
+#include "sphere.hxx"   // sphere, sphere4
+
+#include <algorithm> // std::ranges::transform
+#include <array>     // std::array
+#include <cstddef>   // std::size_t
+#include <cstdint>   // uint32_t
+#include <ranges>    // std::views::iota
+#include <span>      // std::span
+#include <vector>    // std::vector
+
+/**
+ * @brief Many spheres as a single hittable, stored four by four in the leaves of their own hierarchy.
+ */
+class sphere_set : public hittable
+{
+public:
+
+    explicit sphere_set(std::vector<sphere> spheres) : m_spheres(std::move(spheres))
+    {
+        std::vector<aabb> boxes(m_spheres.size());
+        std::ranges::transform(m_spheres, boxes.begin(), [](sphere const& s) { return s.bounding_box(); });
+        m_tree = bvh_tree(boxes, sphere4::width);
+        m_tree.align_leaves(sphere4::width);
+        fill_blocks();
+    }
+
+    /**
+     * @brief Wraps spheres with the hierarchy built for them before, taken from tree(), without building anything.
+     */
+    sphere_set(std::vector<sphere> spheres, bvh_tree tree) : m_spheres(std::move(spheres)), m_tree(std::move(tree))
+    {
+        fill_blocks();
+    }
+
+    auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
+    {
+        uint32_t hit_sphere{0};
+        auto hit_t = 0.0;
+        auto const found = m_tree.closest_hit(r, ray_interval, [&](uint32_t first, uint32_t /* count */, interval& range) {
+            auto const& block = m_blocks[first / sphere4::width];
+            auto const lane = block.intersect(r, range, hit_t);
+
+            if (lane == sphere4::width) { return false; }
+
+            hit_sphere = block.index[lane];
+            range.max = hit_t;
+
+            return true;
+        });
+
+        if (!found) { return false; }
+
+        fill_record(r, hit_sphere, hit_t, rec);
+
+        return true;
+    }
+
+    auto hit_packet(ray_packet& packet) const -> void override
+    {
+        std::array<uint32_t, ray_packet::width> hit_sphere{};
+        uint32_t hits{0};
+
+        m_tree.closest_hit(packet, [&](uint32_t first, uint32_t /* count */) {
+            auto const& block = m_blocks[first / sphere4::width];
+
+            for_each_lane(packet.active, [&](uint32_t const lane) {
+                auto t = 0.0;
+                auto const k = block.intersect(packet.rays[lane], packet.ranges[lane], t);
+
+                if (k == sphere4::width) { return; }
+
+                hit_sphere[lane] = block.index[k];
+                hits |= 1U << lane;
+                packet.ranges[lane].max = t;
+            });
+        });
+
+        for_each_lane(hits, [&](uint32_t const lane) {
+            fill_record(packet.rays[lane], hit_sphere[lane], packet.ranges[lane].max, packet.records[lane]);
+        });
+        packet.hits |= hits;
+    }
+
+    auto any_hit(ray const& r, interval ray_interval) const -> bool override
+    {
+        return m_tree.any_hit(r, ray_interval, [this, &r](uint32_t first, uint32_t /* count */, interval const& range) {
+            auto t = 0.0;
+
+            return m_blocks[first / sphere4::width].intersect(r, range, t) != sphere4::width;
+        });
+    }
+
+    auto bounding_box() const -> aabb override { return m_tree.bounding_box(); }
+
+    auto spheres() const -> std::span<sphere const> { return m_spheres; }
+
+    auto tree() const -> bvh_tree const& { return m_tree; }
+
+private:
+
+    auto fill_blocks() -> void
+    {
+        auto const indices = m_tree.indices();
+        m_blocks.resize(indices.size() / sphere4::width);
+
+        for (auto const k : std::views::iota(std::size_t{0}, indices.size()))
+        {
+            if (indices[k] == bvh_tree::invalid_index) { continue; }
+
+            auto const& s = m_spheres[indices[k]];
+            m_blocks[k / sphere4::width].set(k % sphere4::width, s.center(), s.radius(), indices[k]);
+        }
+    }
+
+    auto fill_record(ray const& r, uint32_t index, double t, hit_record& rec) const -> void
+    {
+        auto const& s = m_spheres[index];
+        rec.t = t;
+        rec.p = r.at(rec.t);
+        rec.set_face_normal(r, (rec.p - s.center()) / s.radius());
+        rec.mat_id = s.mat_id();
+    }
+
+    std::vector<sphere> m_spheres;
+    bvh_tree m_tree;
+    std::vector<sphere4> m_blocks;
+};
@@ -2,55 +2,152 @@
 
 #include "hittable.hxx" // hittable
 #include "ray.hxx"      // ray
+#include "simd.hxx"     // double4, vec3x4, closest_lane
 #include "vec3.hxx"     // vec3
 
-class triangle : public hittable
+#include <array>    // std::array
+#include <cstdint>  // uint32_t
+#include <optional> // std::optional
+#include <tuple>    // std::tie, std::tuple
+
+/**
+ * @brief Möller–Trumbore ray-triangle intersection.
+ * @param r            The ray to test.
+ * @param v0           The first vertex of the triangle.
+ * @param edge1        The edge from the first to the second vertex.
+ * @param edge2        The edge from the first to the third vertex.
+ * @param ray_interval The parametric range to accept.
+ * @return The distance along the ray of the intersection, if any.
+ */
+constexpr auto intersect_triangle(ray const& r, point3 const& v0, vec3 const& edge1, vec3 const& edge2,
+                                  interval const& ray_interval) -> std::optional<double>
 {
-public:
+    auto const epsilon = 0.0000001;
 
-    triangle(vec3 const& v0, vec3 const& v1, vec3 const& v2, std::shared_ptr<material> material_ptr)
-        : m_v0(v0), m_v1(v1), m_v2(v2), m_material_ptr(std::move(material_ptr))
-    {}
+    auto const h = cross(r.direction(), edge2);
+    auto const a = dot(edge1, h);
 
-    auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
+    if (a > -epsilon && a < epsilon) { return std::nullopt; }
+
+    auto const f = 1.0 / a;
+    auto const s = r.origin() - v0;
+    auto const u = f * dot(s, h);
+
+    if (u < 0.0 || u > 1.0) { return std::nullopt; }
+
+    auto const q = cross(s, edge1);
+    auto const v = f * dot(r.direction(), q);
+
+    if (v < 0.0 || u + v > 1.0) { return std::nullopt; }
+
+    auto const t = f * dot(edge2, q);
+
+    if (!ray_interval.contains(t)) { return std::nullopt; }
+
+    return t;
+}
+
+/**
+ * @brief Four triangles in structure-of-arrays layout, tested against one ray at once.
+ * Unused lanes keep null edges, which the determinant test always rejects.
+ */
+struct triangle4
+{
+    static constexpr uint32_t width{double4::width};
+
+    std::array<double, width> v0_x{};
+    std::array<double, width> v0_y{};
+    std::array<double, width> v0_z{};
+    std::array<double, width> edge1_x{};
+    std::array<double, width> edge1_y{};
+    std::array<double, width> edge1_z{};
+    std::array<double, width> edge2_x{};
+    std::array<double, width> edge2_y{};
+    std::array<double, width> edge2_z{};
+    std::array<uint32_t, width> index{~0U, ~0U, ~0U, ~0U};
+
+    auto set(uint32_t lane, point3 const& v0, point3 const& v1, point3 const& v2, uint32_t triangle_index) -> void
     {
-        auto const epsilon = 0.0000001;
+        auto const edge1 = v1 - v0;
+        auto const edge2 = v2 - v0;
+        std::tie(v0_x[lane], v0_y[lane], v0_z[lane]) = std::tuple(v0.x(), v0.y(), v0.z());
+        std::tie(edge1_x[lane], edge1_y[lane], edge1_z[lane]) = std::tuple(edge1.x(), edge1.y(), edge1.z());
+        std::tie(edge2_x[lane], edge2_y[lane], edge2_z[lane]) = std::tuple(edge2.x(), edge2.y(), edge2.z());
+        index[lane] = triangle_index;
+    }
 
-        auto const edge1 = m_v1 - m_v0;
-        auto const edge2 = m_v2 - m_v0;
-        auto const h = cross(r.direction(), edge2);
-        auto const a = dot(edge1, h);
+    /**
+     * @brief Möller–Trumbore test of the four triangles, the same arithmetic as intersect_triangle.
+     * @param r            The ray to test.
+     * @param ray_interval The parametric range to accept.
+     * @param t            Set to the distance of the closest hit, if any.
+     * @return The lane of the closest hit, or width if there is none.
+     */
+    auto intersect(ray const& r, interval const& ray_interval, double& t) const -> uint32_t
+    {
+        static constexpr auto epsilon = 0.0000001;
 
-        if (a > -epsilon && a < epsilon) { return false; }
+        vec3x4 const direction{double4(r.direction().x()), double4(r.direction().y()), double4(r.direction().z())};
+        vec3x4 const origin{double4(r.origin().x()), double4(r.origin().y()), double4(r.origin().z())};
+        vec3x4 const v0{double4::load(v0_x), double4::load(v0_y), double4::load(v0_z)};
+        vec3x4 const edge1{double4::load(edge1_x), double4::load(edge1_y), double4::load(edge1_z)};
+        vec3x4 const edge2{double4::load(edge2_x), double4::load(edge2_y), double4::load(edge2_z)};
 
-        auto const f = 1.0 / a;
-        auto const s = r.origin() - m_v0;
-        auto const u = f * dot(s, h);
+        auto const h = cross(direction, edge2);
+        auto const a = dot(edge1, h);
+        auto valid = (a <= double4(-epsilon)) | (a >= double4(epsilon));
 
-        if (u < 0.0 || u > 1.0) { return false; }
+        auto const f = double4(1.0) / a;
+        auto const s = origin - v0;
+        auto const u = f * dot(s, h);
+        valid = valid & (u >= double4(0.0)) & (u <= double4(1.0));
 
         auto const q = cross(s, edge1);
-        auto const v = f * dot(r.direction(), q);
+        auto const v = f * dot(direction, q);
+        valid = valid & (v >= double4(0.0)) & (u + v <= double4(1.0));
+
+        auto const distance = f * dot(edge2, q);
+        valid = valid & (distance >= double4(ray_interval.min)) & (distance <= double4(ray_interval.max));
 
-        if (v < 0.0 || u + v > 1.0) { return false; }
+        return closest_lane(valid.mask(), distance, t);
+    }
+};
 
-        auto const t = f * dot(edge2, q);
+class triangle : public hittable
+{
+public:
 
-        if (!ray_interval.contains(t)) { return false; }
+    triangle(vec3 const& v0, vec3 const& v1, vec3 const& v2, material_id mat_id)
+        : m_v0(v0), m_v1(v1), m_v2(v2), m_mat_id(mat_id)
+    {}
 
-        rec.t = t;
+    auto hit(ray const& r, interval ray_interval, hit_record& rec) const -> bool override
+    {
+        auto const edge1 = m_v1 - m_v0;
+        auto const edge2 = m_v2 - m_v0;
+        auto const t = intersect_triangle(r, m_v0, edge1, edge2, ray_interval);
+
+        if (!t) { return false; }
+
+        rec.t = *t;
         rec.p = r.at(rec.t);
-        auto const outward_normal = cross(edge1, edge2);
-        rec.set_face_normal(r, outward_normal);
-        rec.mat_ptr = m_material_ptr;
+        rec.set_face_normal(r, unit_vector(cross(edge1, edge2)));
+        rec.mat_id = m_mat_id;
 
         return true;
     }
 
+    auto any_hit(ray const& r, interval ray_interval) const -> bool override
+    {
+        return intersect_triangle(r, m_v0, m_v1 - m_v0, m_v2 - m_v0, ray_interval).has_value();
+    }
+
+    auto bounding_box() const -> aabb override { return aabb(aabb(m_v0, m_v1), aabb(m_v2, m_v2)).pad(); }
+
 private:
 
     vec3 m_v0;
     vec3 m_v1;
     vec3 m_v2;
-    std::shared_ptr<material> m_material_ptr;
+    material_id m_mat_id;
 };
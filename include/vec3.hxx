@@ -1,6 +1,6 @@
 #pragma once
 
-#include "helpers.hxx" // random_double
+#include "helpers.hxx" // random_double, sampler
 
 #include <algorithm>
 #include <array>    // std::array
@@ -32,11 +32,11 @@ public:
         return (std::fabs(e[0]) < s) && (std::fabs(e[1]) < s) && (std::fabs(e[2]) < s);
     }
 
-    static auto random() -> vec3 { return {random_double(), random_double(), random_double()}; }
+    static auto random(sampler& rng) -> vec3 { return {random_double(rng), random_double(rng), random_double(rng)}; }
 
-    static auto random(double min, double max) -> vec3
+    static auto random(sampler& rng, double min, double max) -> vec3
     {
-        return {random_double(min, max), random_double(min, max), random_double(min, max)};
+        return {random_double(rng, min, max), random_double(rng, min, max), random_double(rng, min, max)};
     }
 
     constexpr auto operator-() const -> vec3 { return {-e[0], -e[1], -e[2]}; }
@@ -147,25 +147,26 @@ inline auto unit_vector(vec3 v) -> vec3 { return v / v.length(); }
 /**
  * @brief Returns a random vector with components in the range [min,max).
  * Repeatedly generates random samples until one matches the criteria.
+ * @param rng The sampler to draw from.
  * @param min The minimum value for each component.
  * @param max The maximum value for each component.
  * @return A random vector with components in the range [min,max).
  */
-inline auto random_in_unit_sphere(double min = -1.0, double max = 1.0) -> vec3
+inline auto random_in_unit_sphere(sampler& rng, double min = -1.0, double max = 1.0) -> vec3
 {
     for (;;)
     {
-        auto const p = vec3::random(min, max);
+        auto const p = vec3::random(rng, min, max);
 
         if (p.length_squared() < 1) { return p; }
     }
 }
 
-inline auto random_unit_vector() -> vec3 { return unit_vector(random_in_unit_sphere()); }
+inline auto random_unit_vector(sampler& rng) -> vec3 { return unit_vector(random_in_unit_sphere(rng)); }
 
-inline auto random_on_hemisphere(vec3 const& normal) -> vec3
+inline auto random_on_hemisphere(sampler& rng, vec3 const& normal) -> vec3
 {
-    auto const in_unit_sphere = random_in_unit_sphere();
+    auto const in_unit_sphere = random_in_unit_sphere(rng);
 
     if (dot(in_unit_sphere, normal) > 0.0) { return in_unit_sphere; }
     return -in_unit_sphere;
@@ -1,106 +1,45 @@
-#include "camera.hxx"        // camera
-#include "hittable_list.hxx" // hittable_list
-#include "material.hxx"      // lambertian, metal, dialectric
-#include "sphere.hxx"        // sphere
-#include "triangle.hxx"      // triangle
+#include "image.hxx"       // write_image
+#include "scene_cache.hxx" // load_scene
 
-#include <algorithm>  // std::ranges::for_each
-#include <charconv>   // std::from_chars
-#include <filesystem> // std::filesystem::path
-#include <fstream>    // std::ifstream
-#include <ranges>     // std::views::iota
-#include <stdexcept>  // std::runtime_error
+#include <filesystem>  // std::filesystem::path
+#include <format>      // std::format
+#include <iostream>    // std::cout, std::cerr
+#include <span>        // std::span
+#include <string_view> // std::string_view
 
-auto load_mesh(std::filesystem::path const& path, std::shared_ptr<material> p_material) -> std::vector<std::shared_ptr<hittable>>
+auto main(int argc, char* argv[]) -> int
 {
-    if (!std::filesystem::exists(path))
-    {
-        throw std::filesystem::filesystem_error("file not found", path,
-                                                std::make_error_code(std::errc::no_such_file_or_directory));
-    }
+    auto args = std::span(argv, static_cast<std::size_t>(argc));
+    auto const program = args[0];
+    args = args.subspan(1);
 
-    std::ifstream file(path);
-    if (!file.is_open()) [[unlikely]] { throw std::runtime_error("file not opened"); }
+    // --passes also writes the image after each pass of an adaptive render, next to the output image.
+    auto const write_passes = !args.empty() && std::string_view(args[0]) == "--passes";
 
-    static constexpr std::ptrdiff_t vertex_count_offset{15L};
-    static constexpr std::ptrdiff_t face_count_offset{13L};
-    std::size_t vertex_count{0UL};
-    std::size_t face_count{0UL};
-    std::string line;
+    if (write_passes) { args = args.subspan(1); }
 
-    while (std::getline(file, line))
+    if (args.empty() || (write_passes && args.size() < 2))
     {
-        if (line.starts_with("end_header")) { break; }
-
-        auto const* start = line.data();
-        auto const* end = line.data();
-        std::ranges::advance(end, static_cast<std::ptrdiff_t>(line.size()));
-
-        if (line.starts_with("element vertex"))
-        {
-            std::ranges::advance(start, vertex_count_offset);
-            auto const [ptr, ec] = std::from_chars(start, end, vertex_count);
-
-            if (ec != std::errc()) [[unlikely]] { throw std::runtime_error("invalid vertex count"); }
-        }
-        else if (line.starts_with("element face"))
-        {
-            std::ranges::advance(start, face_count_offset);
-            auto const [ptr, ec] = std::from_chars(start, end, face_count);
-
-            if (ec != std::errc()) [[unlikely]] { throw std::runtime_error("invalid face count"); }
-        }
+        std::cerr << "usage: " << program << " [--passes] <scene file> [output image]\n";
+        return 1;
     }
 
-    std::vector<vec3> vertices;
-    std::vector<std::shared_ptr<hittable>> triangles;
-    vertices.reserve(vertex_count);
-    triangles.reserve(face_count);
-    std::ranges::for_each(std::views::iota(0UL, vertex_count), [&vertices, &file]([[maybe_unused]] std::size_t const idx) {
-        float x{0.0F};
-        float y{0.0F};
-        float z{0.0F};
-        file >> x >> y >> z;
-        vertices.emplace_back(x, y, z);
-    });
-
-    std::ranges::for_each(std::views::iota(0UL, face_count), [&]([[maybe_unused]] std::size_t const idx) {
-        std::size_t v1{0UL};
-        std::size_t v2{0UL};
-        std::size_t v3{0UL};
-        file >> vertex_count >> v1 >> v2 >> v3;
-        triangles.emplace_back(std::make_shared<triangle>(vertices[v1], vertices[v2], vertices[v3], p_material));
-    });
+    auto s = load_scene(std::filesystem::path(args[0]));
 
-    return triangles;
-}
-
-auto main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[]) -> int
-{
-    hittable_list world;
-    std::vector<light> lights;
-    lights.emplace_back(light{vec3{0.0, 0.0, 0.0}, color_from_rgb(0xFF, 0xFF, 0xFF), 1.0});
+    if (write_passes)
+    {
+        s.view.on_pass = [output = std::filesystem::path(args[1])](framebuffer const& image, uint32_t const pass) {
+            auto path = output;
+            path.replace_filename(std::format("{}.pass{}{}", output.stem().string(), pass + 1, output.extension().string()));
+            write_image(image, path);
+        };
+    }
 
-    auto const ground_material = std::make_shared<lambertian>(color{0.8, 0.8, 0.0});
-    auto const center_material = std::make_shared<lambertian>(color{0.1, 0.2, 0.5});
-    auto const left_material = std::make_shared<dielectric>(1.5);
-    auto const right_material = std::make_shared<metal>(color{0.8, 0.6, 0.2}, 0.0);
-    auto const ground = std::make_shared<sphere>(point3{0.0, -100.5, -1.0}, 100.0, ground_material);
-    auto const center_sphere = std::make_shared<sphere>(point3{0.0, 0.0, -1.0}, 0.5, center_material);
-    auto const left_sphere = std::make_shared<sphere>(point3{-1.0, 0.0, -1.0}, 0.5, left_material);
-    auto const right_sphere = std::make_shared<sphere>(point3{1.0, 0.0, -1.0}, 0.5, right_material);
+    auto const image = s.view.render(s.world(), s.materials, s.lights);
 
-    world.add(ground);
-    world.add(center_sphere);
-    world.add(left_sphere);
-    world.add(right_sphere);
+    // An output path selects the format from its extension, without one the image goes to stdout as before.
+    if (args.size() > 1) { write_image(image, std::filesystem::path(args[1])); }
+    else { write_image(image, std::cout, image_format::ppm_ascii); }
 
-    camera view;
-    view.aspect_ratio = 16.0 / 9.0;
-    view.image_width = 400;
-    view.samples_per_pixel = 100;
-    view.max_depth = 100;
-    view.render(world, lights);
-    
     return 0;
-}
\ No newline at end of file
+}